@@ -0,0 +1,264 @@
+#include "assetLoader.h"
+#include "..\Model Loading\meshLoaderObj.h"
+#include "..\Model Loading\texture.h"
+#include "..\Model Loading\textureLoader.h"
+#include "..\Model Loading\textureStaging.h"
+#include "vfs.h"
+#include <iostream>
+#include <iomanip>
+
+AssetLoader::AssetLoader(AssetRegistry &registry, unsigned int workerCount) : registry(registry)
+{
+	vertexFormat = VertexFormat::Packed;
+
+	if (workerCount > 0)
+		pool.reset(new ThreadPool(workerCount));
+
+	pending = 0;
+	requests = 0;
+	shared = 0;
+	cpuSeconds = 0.0;
+	uploadSeconds = 0.0;
+	decodedImages = 0;
+	decodeSeconds = 0.0;
+	decodedBytes = 0;
+	decodedPixels = 0;
+	start = Clock::now();
+}
+
+AssetLoader::~AssetLoader()
+{
+	finish();
+}
+
+Texture AssetLoader::loadTexture(const std::string &path, const std::string &type)
+{
+	std::shared_ptr<TextureResource> resource = registry.findTexture(path);
+
+	if (resource)
+	{
+		beginBatch();
+		shared++;
+	}
+	else
+	{
+		resource = std::make_shared<TextureResource>();
+		glGenTextures(1, &resource->id);
+		registry.addTexture(path, resource);
+
+		submit([this, path, resource]() -> std::function<void()> {
+			std::shared_ptr<TextureData> data = std::make_shared<TextureData>();
+			if (!TextureLoader::readTexture(path, *data))
+				return [resource, path]() { TextureLoader::uploadFallback(*resource, path); };
+
+			return [this, resource, data]() {
+				TextureLoader::upload(*resource, *data);
+
+				if (!data->cached)
+				{
+					decodedImages++;
+					decodeSeconds += data->decodeSeconds;
+					decodedBytes += data->decodedBytes;
+					decodedPixels += data->decodedPixels;
+				}
+			};
+		});
+	}
+
+	Texture texture;
+	texture.id = resource->id;
+	texture.type = type;
+	texture.resource = resource;
+
+	return texture;
+}
+
+void AssetLoader::loadMesh(Mesh &target, const std::string &path, std::vector<Texture> textures, MeshResidency residency)
+{
+	bool keepCpuData = residency == MeshResidency::KeepCpuData;
+	std::shared_ptr<MeshGeometry> geometry = registry.findMesh(path);
+
+	//a pending upload picks up the flag, uploaded geometry has to read the file again for its CPU copy
+	bool reread = geometry && keepCpuData && !geometry->keepCpuData && geometry->isUploaded();
+	if (geometry && keepCpuData)
+		geometry->keepCpuData = true;
+
+	if (geometry && !reread)
+	{
+		beginBatch();
+		shared++;
+	}
+	else
+	{
+		if (!geometry)
+		{
+			geometry = std::make_shared<MeshGeometry>();
+			geometry->keepCpuData = keepCpuData;
+			registry.addMesh(path, geometry);
+		}
+
+		VertexFormat format = vertexFormat;
+		submit([path, geometry, format]() -> std::function<void()> {
+			std::shared_ptr<MeshData> data = std::make_shared<MeshData>();
+			bool found = MeshLoaderObj::readObj(path, *data);
+
+			return [path, geometry, format, data, found]() {
+				if (!found)
+				{
+					std::cout << "Obj model not found " << path << std::endl;
+					std::terminate();
+				}
+
+				if (geometry->isUploaded())
+				{
+					geometry->vertices.assign(data->getVertices(), data->getVertices() + data->getVertexCount());
+					geometry->indices.assign(data->getIndices(), data->getIndices() + data->getIndexCount());
+					return;
+				}
+
+				std::cout << "Loading:  " << path << (data->cached ? " (cached)" : "") << std::endl;
+				*geometry = MeshBuilder()
+					.setVertices(data->getVertices(), data->getVertexCount())
+					.setIndices(data->getIndices(), data->getIndexCount())
+					.setLods(data->getLods(), data->getLodCount())
+					.setResidency(geometry->keepCpuData ? MeshResidency::KeepCpuData : MeshResidency::GpuOnly)
+					.setVertexFormat(format)
+					.build();
+			};
+		});
+	}
+
+	target = Mesh(geometry, std::move(textures));
+}
+
+void AssetLoader::setVertexFormat(VertexFormat format)
+{
+	vertexFormat = format;
+}
+
+void AssetLoader::beginBatch()
+{
+	//the wall clock of a batch starts at its first request, not when the previous one was reported
+	if (requests == 0 && shared == 0)
+		start = Clock::now();
+}
+
+void AssetLoader::submit(std::function<std::function<void()>()> job)
+{
+	beginBatch();
+	requests++;
+
+	if (!pool)
+	{
+		Clock::time_point jobStart = Clock::now();
+		std::function<void()> upload = job();
+		cpuSeconds += std::chrono::duration<double>(Clock::now() - jobStart).count();
+
+		runUpload(upload);
+		return;
+	}
+
+	pending++;
+	pool->enqueue([this, job]() mutable {
+		Clock::time_point jobStart = Clock::now();
+		std::function<void()> upload = job();
+		double seconds = std::chrono::duration<double>(Clock::now() - jobStart).count();
+
+		//drop the job's references here, while the upload step still holds its own,
+		//so GL objects are never released from a worker thread
+		job = nullptr;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			cpuSeconds += seconds;
+			uploads.push_back(std::move(upload));
+		}
+		uploadReady.notify_one();
+	});
+}
+
+void AssetLoader::runUpload(const std::function<void()> &upload)
+{
+	Clock::time_point uploadStart = Clock::now();
+	upload();
+	uploadSeconds += std::chrono::duration<double>(Clock::now() - uploadStart).count();
+}
+
+bool AssetLoader::update(double maxSeconds)
+{
+	Clock::time_point updateStart = Clock::now();
+
+	while (pending > 0 && std::chrono::duration<double>(Clock::now() - updateStart).count() < maxSeconds)
+	{
+		std::function<void()> upload;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (uploads.empty())
+				break;
+			upload = std::move(uploads.front());
+			uploads.erase(uploads.begin());
+		}
+
+		runUpload(upload);
+		pending--;
+	}
+
+	if (pending > 0)
+		return false;
+
+	//the batch just completed; later calls find nothing left to report
+	if (requests > 0 || shared > 0)
+		report();
+	return true;
+}
+
+void AssetLoader::finish()
+{
+	while (pending > 0)
+	{
+		std::vector<std::function<void()>> ready;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			uploadReady.wait(lock, [this] { return !uploads.empty(); });
+			ready.swap(uploads);
+		}
+
+		for (const std::function<void()> &upload : ready)
+		{
+			runUpload(upload);
+			pending--;
+		}
+	}
+
+	if (requests > 0 || shared > 0)
+		report();
+}
+
+void AssetLoader::report()
+{
+	double wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+	double serialSeconds = cpuSeconds + uploadSeconds;
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "Asset loading: " << requests << " files (" << shared << " repeated requests shared) on " << (pool ? pool->getThreadCount() : 0) << " worker threads" << (pool ? "" : " (serial)") << std::endl;
+	std::cout << "  wall clock        " << std::setw(8) << wallSeconds * 1000.0 << " ms" << std::endl;
+	std::cout << "  CPU jobs          " << std::setw(8) << cpuSeconds * 1000.0 << " ms  (file I/O, OBJ parsing, image decoding)" << std::endl;
+	if (decodedImages > 0)
+		std::cout << "  image decoding    " << std::setw(8) << decodeSeconds * 1000.0 << " ms  (" << decodedImages << " images, "
+			<< decodedBytes / (1024.0 * 1024.0) / decodeSeconds << " MB/s of files, " << decodedPixels / 1e6 / decodeSeconds << " Mpixel/s)" << std::endl;
+	std::cout << "  files             " << std::setw(8) << Vfs::getPackReads() << " from the pack, " << Vfs::getLooseReads() << " loose" << std::endl;
+	std::cout << "  GL uploads        " << std::setw(8) << uploadSeconds * 1000.0 << " ms" << std::endl;
+	std::cout << "  texture staging   " << std::setw(8) << TextureStaging::shared().getStagedBytes() / 1024.0 << " KB  (" << TextureStaging::shared().getWaits() << " waits on the GPU)" << std::endl;
+	std::cout << "  serial estimate   " << std::setw(8) << serialSeconds * 1000.0 << " ms  (" << std::setprecision(2) << serialSeconds / wallSeconds << "x)" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+
+	requests = 0;
+	shared = 0;
+	cpuSeconds = 0.0;
+	uploadSeconds = 0.0;
+	decodedImages = 0;
+	decodeSeconds = 0.0;
+	decodedBytes = 0;
+	decodedPixels = 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <memory>
+#include "threadPool.h"
+#include "assetRegistry.h"
+#include "..\Model Loading\mesh.h"
+
+//Loads meshes and textures for startup.
+//File I/O, OBJ parsing and image decoding run on worker threads; each finished job
+//hands back a GL step that finish() runs on the calling (GL) thread to create the
+//VAOs, buffers and textures. With zero workers every job runs inline, which is the old serial path.
+//Paths already in the registry are not read again; the request shares the existing GPU object.
+class AssetLoader
+{
+	public:
+		AssetLoader(AssetRegistry &registry, unsigned int workerCount);
+		~AssetLoader();
+
+		//the texture name is generated right away, so the returned Texture can be handed to meshes immediately
+		Texture loadTexture(const std::string &path, const std::string &type);
+		//target shares the geometry right away, its buffers are filled during finish()
+		//the vertices and indices are only kept in RAM when a caller asks for MeshResidency::KeepCpuData
+		void loadMesh(Mesh &target, const std::string &path, std::vector<Texture> textures, MeshResidency residency = MeshResidency::GpuOnly);
+
+		//layout of the vertex buffers of meshes loaded from now on, VertexFormat::Packed by default
+		void setVertexFormat(VertexFormat format);
+
+		//runs the GL uploads as jobs complete until every request is done, then prints the timing report
+		void finish();
+		//runs the uploads of jobs that are already done for at most maxSeconds without waiting on the rest,
+		//so loading can continue in the background between frames; true once every request is done.
+		//The report is printed once, by the call that completes the batch
+		bool update(double maxSeconds);
+
+	private:
+		typedef std::chrono::high_resolution_clock Clock;
+
+		//a job does the CPU work and returns the GL step that completes it
+		void submit(std::function<std::function<void()>()> job);
+		void runUpload(const std::function<void()> &upload);
+		void beginBatch();
+		//prints the timing of the batch that just completed and starts counting the next one
+		void report();
+
+		AssetRegistry &registry;
+		VertexFormat vertexFormat;
+		std::unique_ptr<ThreadPool> pool;
+		std::mutex mutex;
+		std::condition_variable uploadReady;
+		std::vector<std::function<void()>> uploads;
+
+		unsigned int pending;
+		unsigned int requests;
+		unsigned int shared;
+		double cpuSeconds;
+		double uploadSeconds;
+		unsigned int decodedImages;
+		double decodeSeconds;
+		size_t decodedBytes;
+		size_t decodedPixels;
+		Clock::time_point start;
+};
@@ -0,0 +1,166 @@
+#include "assetPack.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+static const char ASSET_PACK_MAGIC[4] = { 'M', 'A', 'W', 'P' };
+static const uint64_t ASSET_PACK_ALIGNMENT = 64;
+
+static uint64_t alignUp(uint64_t value)
+{
+	return (value + ASSET_PACK_ALIGNMENT - 1) & ~(ASSET_PACK_ALIGNMENT - 1);
+}
+
+bool AssetPack::write(const std::string &packPath, const std::vector<std::string> &directories)
+{
+	//collect and sort the paths, the runtime binary searches them
+	std::vector<std::pair<std::string, std::filesystem::path>> files;
+	for (const std::string &directory : directories)
+	{
+		std::error_code error;
+		for (const auto &entry : std::filesystem::recursive_directory_iterator(directory, error))
+		{
+			if (!entry.is_regular_file())
+				continue;
+
+			std::string name = std::filesystem::path(entry.path()).lexically_normal().generic_string();
+			//half written caches are never packed, nor program binaries that only fit one driver
+			if (name.find(".tmp") != std::string::npos || std::filesystem::path(name).extension() == ".mawprog")
+				continue;
+			files.push_back(std::make_pair(name, entry.path()));
+		}
+	}
+	std::sort(files.begin(), files.end());
+
+	AssetPackHeader h;
+	memcpy(h.magic, ASSET_PACK_MAGIC, 4);
+	h.version = VERSION;
+	h.entryCount = (uint32_t)files.size();
+	h.entryStride = sizeof(AssetPackEntry);
+	h.entryOffset = alignUp(sizeof(AssetPackHeader));
+	h.namesOffset = h.entryOffset + (uint64_t)h.entryCount * h.entryStride;
+
+	std::vector<AssetPackEntry> entries(files.size());
+	std::string names;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		entries[i].nameOffset = names.size();
+		entries[i].nameLength = (uint32_t)files[i].first.size();
+		entries[i].flags = 0;
+		entries[i].size = std::filesystem::file_size(files[i].second);
+		names += files[i].first;
+	}
+	h.namesSize = names.size();
+
+	uint64_t offset = alignUp(h.namesOffset + h.namesSize);
+	for (AssetPackEntry &entry : entries)
+	{
+		entry.dataOffset = offset;
+		offset = alignUp(offset + entry.size);
+	}
+
+	//same temporary name + rename dance as the caches
+	std::string tempPath = packPath + ".tmp";
+	std::ofstream out(tempPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.good())
+		return false;
+
+	static const char padding[ASSET_PACK_ALIGNMENT] = {};
+
+	out.write((const char*)&h, sizeof(h));
+	out.write(padding, h.entryOffset - sizeof(h));
+	out.write((const char*)entries.data(), (std::streamsize)entries.size() * sizeof(AssetPackEntry));
+	out.write(names.data(), (std::streamsize)names.size());
+
+	uint64_t written = h.namesOffset + h.namesSize;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		out.write(padding, entries[i].dataOffset - written);
+
+		MappedFile source(files[i].second.string());
+		if (!source.isOpen() || source.size() != entries[i].size)
+		{
+			std::cout << "Could not pack " << files[i].first << std::endl;
+			out.close();
+			std::remove(tempPath.c_str());
+			return false;
+		}
+		out.write(source.data(), (std::streamsize)source.size());
+		written = entries[i].dataOffset + entries[i].size;
+	}
+	out.close();
+
+	if (!out.good())
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	std::remove(packPath.c_str());
+	if (std::rename(tempPath.c_str(), packPath.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	std::cout << "Packed " << files.size() << " files into " << packPath << " (" << written / 1024 << " KB)" << std::endl;
+	return true;
+}
+
+bool AssetPack::open(const std::string &path)
+{
+	header = nullptr;
+	if (!file.open(path) || file.size() < sizeof(AssetPackHeader))
+		return false;
+
+	const AssetPackHeader* h = (const AssetPackHeader*)file.data();
+	if (memcmp(h->magic, ASSET_PACK_MAGIC, 4) != 0 || h->version != VERSION || h->entryStride != sizeof(AssetPackEntry))
+		return false;
+
+	if (h->entryOffset + (uint64_t)h->entryCount * h->entryStride > file.size() || h->namesOffset + h->namesSize > file.size())
+		return false;
+
+	const AssetPackEntry* entries = (const AssetPackEntry*)(file.data() + h->entryOffset);
+	for (uint32_t i = 0; i < h->entryCount; i++)
+	{
+		if (entries[i].nameOffset + entries[i].nameLength > h->namesSize || entries[i].dataOffset + entries[i].size > file.size())
+			return false;
+	}
+
+	header = h;
+	return true;
+}
+
+bool AssetPack::isOpen() const
+{
+	return header != nullptr;
+}
+
+bool AssetPack::find(const std::string &path, const char* &data, size_t &size) const
+{
+	if (!header)
+		return false;
+
+	const AssetPackEntry* entries = (const AssetPackEntry*)(file.data() + header->entryOffset);
+	const char* names = file.data() + header->namesOffset;
+
+	const AssetPackEntry* found = std::lower_bound(entries, entries + header->entryCount, path, [names](const AssetPackEntry &entry, const std::string &key) {
+		return key.compare(0, std::string::npos, names + entry.nameOffset, entry.nameLength) > 0;
+	});
+
+	if (found == entries + header->entryCount || path.compare(0, std::string::npos, names + found->nameOffset, found->nameLength) != 0)
+		return false;
+
+	data = file.data() + found->dataOffset;
+	size = (size_t)found->size;
+	return true;
+}
+
+unsigned int AssetPack::getEntryCount() const
+{
+	return header ? header->entryCount : 0;
+}
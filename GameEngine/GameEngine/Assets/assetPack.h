@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "..\Model Loading\mappedFile.h"
+
+//Single file holding many assets (.mawpak), opened once and mapped.
+//Layout: AssetPackHeader, the entry table sorted by path, the path strings, then every
+//file's bytes starting on a 64 byte boundary, so cooked .mawmesh / .mawtex files keep the
+//alignment they were written with. flags is 0 (stored) for now; it is where a compressed
+//entry would be marked.
+struct AssetPackHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t entryStride;
+	uint64_t entryOffset;
+	uint64_t namesOffset;
+	uint64_t namesSize;
+};
+
+struct AssetPackEntry
+{
+	uint64_t nameOffset;
+	uint32_t nameLength;
+	uint32_t flags;
+	uint64_t dataOffset;
+	uint64_t size;
+};
+
+class AssetPack
+{
+	public:
+		static const uint32_t VERSION = 1;
+
+		//packs every file below the given directories, stored under paths like "Resources/Models/hut.obj"
+		static bool write(const std::string &packPath, const std::vector<std::string> &directories);
+
+		bool open(const std::string &path);
+		bool isOpen() const;
+
+		//binary search of the directory, path in the normalized form above; false if not packed
+		bool find(const std::string &path, const char* &data, size_t &size) const;
+		unsigned int getEntryCount() const;
+
+	private:
+		MappedFile file;
+		const AssetPackHeader* header = nullptr;
+};
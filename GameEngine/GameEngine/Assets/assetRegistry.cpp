@@ -0,0 +1,97 @@
+#include "assetRegistry.h"
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+
+std::string AssetRegistry::normalizePath(const std::string &path)
+{
+	return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+std::shared_ptr<MeshGeometry> AssetRegistry::findMesh(const std::string &path) const
+{
+	auto it = meshes.find(normalizePath(path));
+	if (it == meshes.end())
+		return nullptr;
+
+	return it->second.lock();
+}
+
+std::shared_ptr<TextureResource> AssetRegistry::findTexture(const std::string &path) const
+{
+	auto it = textures.find(normalizePath(path));
+	if (it == textures.end())
+		return nullptr;
+
+	return it->second.lock();
+}
+
+void AssetRegistry::addMesh(const std::string &path, const std::shared_ptr<MeshGeometry> &geometry)
+{
+	meshes[normalizePath(path)] = geometry;
+}
+
+void AssetRegistry::addTexture(const std::string &path, const std::shared_ptr<TextureResource> &texture)
+{
+	textures[normalizePath(path)] = texture;
+}
+
+std::vector<std::shared_ptr<TextureResource>> AssetRegistry::getTextures() const
+{
+	std::vector<std::shared_ptr<TextureResource>> live;
+
+	for (const auto &entry : textures)
+		if (std::shared_ptr<TextureResource> texture = entry.second.lock())
+			live.push_back(texture);
+
+	return live;
+}
+
+size_t AssetRegistry::getResidentBytes() const
+{
+	size_t total = 0;
+
+	for (const auto &entry : meshes)
+		if (std::shared_ptr<MeshGeometry> geometry = entry.second.lock())
+			total += geometry->residentBytes;
+
+	for (const auto &entry : textures)
+		if (std::shared_ptr<TextureResource> texture = entry.second.lock())
+			total += texture->residentBytes;
+
+	return total;
+}
+
+size_t AssetRegistry::getCpuBytes() const
+{
+	size_t total = 0;
+
+	for (const auto &entry : meshes)
+		if (std::shared_ptr<MeshGeometry> geometry = entry.second.lock())
+			total += geometry->getCpuBytes();
+
+	return total;
+}
+
+void AssetRegistry::printResidency() const
+{
+	std::cout << "Resident assets" << std::endl;
+	std::cout << std::left << std::setw(48) << "path" << std::right << std::setw(8) << "users" << std::setw(12) << "GPU KB" << std::setw(12) << "CPU KB" << std::endl;
+
+	std::cout << std::fixed << std::setprecision(1);
+
+	for (const auto &entry : meshes)
+		if (std::shared_ptr<MeshGeometry> geometry = entry.second.lock())
+			std::cout << std::left << std::setw(48) << entry.first << std::right << std::setw(8) << geometry.use_count() - 1
+				<< std::setw(12) << geometry->residentBytes / 1024.0 << std::setw(12) << geometry->getCpuBytes() / 1024.0 << std::endl;
+
+	for (const auto &entry : textures)
+		if (std::shared_ptr<TextureResource> texture = entry.second.lock())
+			std::cout << std::left << std::setw(48) << entry.first << std::right << std::setw(8) << texture.use_count() - 1
+				<< std::setw(12) << texture->residentBytes / 1024.0 << std::setw(12) << 0.0 << std::endl;
+
+	std::cout << std::left << std::setw(56) << "total" << std::right << std::setw(12) << getResidentBytes() / 1024.0 << std::setw(12) << getCpuBytes() / 1024.0 << std::endl;
+
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+}
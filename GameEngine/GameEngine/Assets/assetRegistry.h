@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <map>
+#include <memory>
+#include <vector>
+#include "..\Model Loading\mesh.h"
+#include "..\Model Loading\texture.h"
+
+//GPU assets keyed by file path, so every request for the same file shares one upload.
+//The registry only holds weak references: an asset is released as soon as the last
+//Mesh or Texture using it goes away, and asking for it again loads it again.
+class AssetRegistry
+{
+	public:
+		std::shared_ptr<MeshGeometry> findMesh(const std::string &path) const;
+		std::shared_ptr<TextureResource> findTexture(const std::string &path) const;
+
+		void addMesh(const std::string &path, const std::shared_ptr<MeshGeometry> &geometry);
+		void addTexture(const std::string &path, const std::shared_ptr<TextureResource> &texture);
+
+		//every live texture, in path order
+		std::vector<std::shared_ptr<TextureResource>> getTextures() const;
+
+		//total GPU bytes of the live assets
+		size_t getResidentBytes() const;
+		//total RAM held by meshes that keep their CPU data
+		size_t getCpuBytes() const;
+		//one line per live asset with its user count and resident GPU and CPU bytes
+		void printResidency() const;
+
+		static std::string normalizePath(const std::string &path);
+
+	private:
+		std::map<std::string, std::weak_ptr<MeshGeometry>> meshes;
+		std::map<std::string, std::weak_ptr<TextureResource>> textures;
+};
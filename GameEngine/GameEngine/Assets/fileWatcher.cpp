@@ -0,0 +1,242 @@
+#include "fileWatcher.h"
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+FileWatcher::FileWatcher()
+{
+	running = true;
+#ifdef _WIN32
+	stopEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+#else
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFd < 0)
+		std::cout << "FileWatcher: inotify is not available" << std::endl;
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+	running = false;
+
+#ifdef _WIN32
+	//the readers wait on this next to their I/O, so none can miss it
+	SetEvent((HANDLE)stopEvent);
+	for (std::thread &reader : threads)
+		reader.join();
+	for (void* handle : directoryHandles)
+		CloseHandle((HANDLE)handle);
+	CloseHandle((HANDLE)stopEvent);
+#else
+	if (thread.joinable())
+		thread.join();
+	if (inotifyFd >= 0)
+		close(inotifyFd);
+#endif
+}
+
+void FileWatcher::record(const std::string &path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	changes[std::filesystem::path(path).lexically_normal().generic_string()] = Clock::now();
+}
+
+std::vector<std::string> FileWatcher::takeChanges()
+{
+	std::vector<std::string> settled;
+	Clock::time_point now = Clock::now();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto it = changes.begin(); it != changes.end();)
+	{
+		if (now - it->second >= std::chrono::milliseconds(SETTLE_MILLISECONDS))
+		{
+			settled.push_back(it->first);
+			it = changes.erase(it);
+		}
+		else
+			++it;
+	}
+
+	return settled;
+}
+
+#ifdef _WIN32
+
+bool FileWatcher::watch(const std::string &directory)
+{
+	HANDLE handle = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "FileWatcher: cannot watch " << directory << std::endl;
+		return false;
+	}
+
+	directoryHandles.push_back(handle);
+	threads.emplace_back(&FileWatcher::readChanges, this, (void*)handle, directory);
+	return true;
+}
+
+void FileWatcher::readChanges(void* directoryHandle, std::string directory)
+{
+	//DWORD aligned, as ReadDirectoryChangesW requires
+	std::vector<DWORD> buffer(16 * 1024);
+
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+	HANDLE waitHandles[2] = { overlapped.hEvent, (HANDLE)stopEvent };
+
+	while (running)
+	{
+		ResetEvent(overlapped.hEvent);
+		BOOL ok = ReadDirectoryChangesW((HANDLE)directoryHandle, buffer.data(), (DWORD)(buffer.size() * sizeof(DWORD)), TRUE,
+			FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE, NULL, &overlapped, NULL);
+		if (!ok)
+			break;
+
+		DWORD bytes = 0;
+		if (WaitForMultipleObjects(2, waitHandles, FALSE, INFINITE) != WAIT_OBJECT_0)
+		{
+			//stopping: the buffer must outlive the cancelled request, so wait for it to finish
+			CancelIoEx((HANDLE)directoryHandle, &overlapped);
+			GetOverlappedResult((HANDLE)directoryHandle, &overlapped, &bytes, TRUE);
+			break;
+		}
+
+		if (!GetOverlappedResult((HANDLE)directoryHandle, &overlapped, &bytes, FALSE))
+			break;
+
+		//zero bytes means the buffer overflowed and the individual changes were lost
+		if (bytes == 0)
+			continue;
+
+		const unsigned char* cursor = (const unsigned char*)buffer.data();
+		while (true)
+		{
+			const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)cursor;
+
+			if (info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+			{
+				int wideLength = (int)(info->FileNameLength / sizeof(WCHAR));
+				int length = WideCharToMultiByte(CP_UTF8, 0, info->FileName, wideLength, NULL, 0, NULL, NULL);
+				std::string name(length, '\0');
+				WideCharToMultiByte(CP_UTF8, 0, info->FileName, wideLength, &name[0], length, NULL, NULL);
+
+				for (char &c : name)
+					if (c == '\\')
+						c = '/';
+
+				record(directory + "/" + name);
+			}
+
+			if (info->NextEntryOffset == 0)
+				break;
+			cursor += info->NextEntryOffset;
+		}
+	}
+
+	CloseHandle(overlapped.hEvent);
+}
+
+#else
+
+bool FileWatcher::watch(const std::string &directory)
+{
+	if (inotifyFd < 0 || !std::filesystem::is_directory(directory))
+	{
+		std::cout << "FileWatcher: cannot watch " << directory << std::endl;
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		addWatches(directory);
+	}
+
+	if (!thread.joinable())
+		thread = std::thread(&FileWatcher::readEvents, this);
+	return true;
+}
+
+void FileWatcher::addWatches(const std::string &directory)
+{
+	//inotify is not recursive, every directory of the tree gets its own watch
+	const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+	int wd = inotify_add_watch(inotifyFd, directory.c_str(), mask);
+	if (wd >= 0)
+		watchedDirectories[wd] = directory;
+
+	std::error_code error;
+	for (const auto &entry : std::filesystem::recursive_directory_iterator(directory, error))
+	{
+		if (!entry.is_directory())
+			continue;
+
+		std::string path = entry.path().generic_string();
+		wd = inotify_add_watch(inotifyFd, path.c_str(), mask);
+		if (wd >= 0)
+			watchedDirectories[wd] = path;
+	}
+}
+
+void FileWatcher::readEvents()
+{
+	alignas(inotify_event) char buffer[16 * 1024];
+
+	while (running)
+	{
+		//wake up regularly to notice the destructor
+		pollfd descriptor = { inotifyFd, POLLIN, 0 };
+		if (poll(&descriptor, 1, 100) <= 0)
+			continue;
+
+		ssize_t bytes = read(inotifyFd, buffer, sizeof(buffer));
+		if (bytes <= 0)
+			continue;
+
+		for (char* cursor = buffer; cursor < buffer + bytes;)
+		{
+			const inotify_event* event = (const inotify_event*)cursor;
+			cursor += sizeof(inotify_event) + event->len;
+			if (event->len == 0)
+				continue;
+
+			std::string directory;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				auto found = watchedDirectories.find(event->wd);
+				if (found == watchedDirectories.end())
+					continue;
+				directory = found->second;
+			}
+
+			std::string path = directory + "/" + event->name;
+			if (event->mask & IN_ISDIR)
+			{
+				if (event->mask & (IN_CREATE | IN_MOVED_TO))
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					addWatches(path);
+				}
+				continue;
+			}
+
+			//a plain IN_CREATE is followed by IN_CLOSE_WRITE once the file is written
+			if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+				record(path);
+		}
+	}
+}
+
+#endif
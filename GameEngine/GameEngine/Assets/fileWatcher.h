@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+//Watches directory trees for files being written, on a background thread.
+//Windows uses overlapped ReadDirectoryChangesW (one reader thread per tree, woken by the
+//I/O or a stop event), everything else inotify.
+//Changes are collected per path and only handed out once the file has been quiet for
+//SETTLE_TIME, so an editor saving in several writes produces a single change.
+class FileWatcher
+{
+	public:
+		static const int SETTLE_MILLISECONDS = 150;
+
+		FileWatcher();
+		~FileWatcher();
+
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		//starts watching a directory and everything below it, false if it cannot be watched
+		bool watch(const std::string &directory);
+
+		//paths (as "directory/relative/file", forward slashes) that changed and have settled since the last call
+		std::vector<std::string> takeChanges();
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		void record(const std::string &path);
+
+		std::mutex mutex;
+		std::map<std::string, Clock::time_point> changes;
+		std::atomic<bool> running;
+
+#ifdef _WIN32
+		void readChanges(void* directoryHandle, std::string directory);
+
+		std::vector<void*> directoryHandles;
+		std::vector<std::thread> threads;
+		//manual reset, signalled once by the destructor for every reader
+		void* stopEvent;
+#else
+		void readEvents();
+		void addWatches(const std::string &directory);
+
+		int inotifyFd;
+		std::map<int, std::string> watchedDirectories;
+		std::thread thread;
+#endif
+};
@@ -0,0 +1,208 @@
+#include "hotReloader.h"
+#include "..\Model Loading\meshLoaderObj.h"
+#include "..\Model Loading\textureLoader.h"
+#include "vfs.h"
+#include <algorithm>
+#include <iostream>
+
+static std::string extensionOf(const std::string &path)
+{
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos)
+		return "";
+
+	std::string extension = path.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return extension;
+}
+
+static bool readText(const std::string &path, std::string &text)
+{
+	VfsFile file(path);
+	if (!file.isOpen())
+		return false;
+
+	text.assign(file.data(), file.size());
+	return true;
+}
+
+HotReloader::HotReloader(AssetRegistry &registry) : registry(registry), pool(1)
+{
+	vertexFormat = VertexFormat::Packed;
+}
+
+HotReloader::~HotReloader()
+{
+}
+
+void HotReloader::watch(const std::string &directory)
+{
+	if (watcher.watch(directory))
+		std::cout << "Hot reload: watching " << directory << std::endl;
+}
+
+void HotReloader::addShader(Shader &shader, const std::string &vertexPath, const std::string &fragmentPath)
+{
+	shaders.push_back(ShaderEntry{ &shader, AssetRegistry::normalizePath(vertexPath), AssetRegistry::normalizePath(fragmentPath) });
+}
+
+void HotReloader::setVertexFormat(VertexFormat format)
+{
+	vertexFormat = format;
+}
+
+void HotReloader::submit(std::function<std::function<void()>()> job)
+{
+	pool.enqueue([this, job]() mutable {
+		std::function<void()> apply = job();
+
+		//as in AssetLoader, GL objects are only ever released on the GL thread
+		job = nullptr;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.push_back(std::move(apply));
+	});
+}
+
+void HotReloader::update()
+{
+	for (const std::string &path : watcher.takeChanges())
+	{
+		std::string extension = extensionOf(path);
+
+		//the edit is on disk, a mounted pack only has the old bytes
+		Vfs::preferLoose(path);
+
+		//only files something is using right now are reloaded
+		if (extension == ".obj")
+		{
+			if (std::shared_ptr<MeshGeometry> geometry = registry.findMesh(path))
+				reloadMesh(path, geometry);
+		}
+		else if (extension == ".bmp" || extension == ".png")
+		{
+			if (std::shared_ptr<TextureResource> texture = registry.findTexture(path))
+				reloadTexture(path, texture);
+		}
+		else if (extension == ".glsl")
+		{
+			for (const ShaderEntry &entry : shaders)
+				if (entry.vertexPath == path || entry.fragmentPath == path)
+					reloadShader(entry);
+		}
+	}
+
+	std::vector<std::function<void()>> finished;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.swap(ready);
+	}
+
+	for (const std::function<void()> &apply : finished)
+		apply();
+}
+
+void HotReloader::reloadMesh(const std::string &path, std::weak_ptr<MeshGeometry> target)
+{
+	VertexFormat format = vertexFormat;
+
+	submit([path, target, format]() -> std::function<void()> {
+		std::shared_ptr<MeshData> data = std::make_shared<MeshData>();
+		if (!MeshLoaderObj::readObj(path, *data) || data->getIndexCount() == 0)
+			return [path]() { std::cout << "Hot reload: " << path << " did not parse, keeping the old mesh" << std::endl; };
+
+		return [path, target, format, data]() {
+			std::shared_ptr<MeshGeometry> geometry = target.lock();
+			if (!geometry)
+				return;
+
+			MeshResidency residency = geometry->keepCpuData ? MeshResidency::KeepCpuData : MeshResidency::GpuOnly;
+
+			//the move assignment releases the old VAO and buffers, every Mesh sharing the geometry draws the new ones
+			*geometry = MeshBuilder()
+				.setVertices(data->getVertices(), data->getVertexCount())
+				.setIndices(data->getIndices(), data->getIndexCount())
+				.setLods(data->getLods(), data->getLodCount())
+				.setResidency(residency)
+				.setVertexFormat(format)
+				.build();
+
+			std::cout << "Hot reload: " << path << " (" << data->getIndexCount() / 3 << " triangles)" << std::endl;
+		};
+	});
+}
+
+void HotReloader::reloadTexture(const std::string &path, std::weak_ptr<TextureResource> target)
+{
+	submit([path, target]() -> std::function<void()> {
+		std::shared_ptr<TextureData> data = std::make_shared<TextureData>();
+		if (!TextureLoader::readTexture(path, *data))
+			return [path]() { std::cout << "Hot reload: " << path << " did not decode, keeping the old texture" << std::endl; };
+
+		return [path, target, data]() {
+			std::shared_ptr<TextureResource> texture = target.lock();
+			if (!texture)
+				return;
+
+			TextureResource fresh;
+			glGenTextures(1, &fresh.id);
+			TextureLoader::upload(fresh, *data);
+
+			bool sameShape = fresh.internalFormat == texture->internalFormat && fresh.width == texture->width &&
+				fresh.height == texture->height && fresh.levelCount == texture->levelCount;
+
+			if (texture->array && sameShape && GLEW_ARB_copy_image)
+			{
+				//still fits its array layer, overwrite the layer and drop the new texture
+				unsigned int width = fresh.width, height = fresh.height;
+				for (unsigned int level = 0; level < fresh.levelCount; level++)
+				{
+					glCopyImageSubData(fresh.id, GL_TEXTURE_2D, level, 0, 0, 0,
+						texture->id, GL_TEXTURE_2D_ARRAY, level, 0, 0, texture->layer,
+						width, height, 1);
+					width = std::max(1u, width / 2);
+					height = std::max(1u, height / 2);
+				}
+			}
+			else
+			{
+				//leave the array (its other layers stay) or replace the plain texture under the same resource
+				if (!texture->array)
+					glDeleteTextures(1, &texture->id);
+
+				texture->id = fresh.id;
+				texture->target = GL_TEXTURE_2D;
+				texture->layer = -1;
+				texture->array.reset();
+				texture->internalFormat = fresh.internalFormat;
+				texture->width = fresh.width;
+				texture->height = fresh.height;
+				texture->levelCount = fresh.levelCount;
+				texture->residentBytes = fresh.residentBytes;
+				fresh.id = 0;
+			}
+
+			std::cout << "Hot reload: " << path << " (" << texture->width << "x" << texture->height << ")" << std::endl;
+		};
+	});
+}
+
+void HotReloader::reloadShader(const ShaderEntry &entry)
+{
+	Shader* shader = entry.shader;
+	std::string vertexPath = entry.vertexPath, fragmentPath = entry.fragmentPath;
+
+	submit([shader, vertexPath, fragmentPath]() -> std::function<void()> {
+		std::shared_ptr<std::string> vertexCode = std::make_shared<std::string>();
+		std::shared_ptr<std::string> fragmentCode = std::make_shared<std::string>();
+		if (!readText(vertexPath, *vertexCode) || !readText(fragmentPath, *fragmentCode))
+			return [vertexPath]() { std::cout << "Hot reload: could not read " << vertexPath << ", keeping the old shader" << std::endl; };
+
+		return [shader, vertexPath, fragmentPath, vertexCode, fragmentCode]() {
+			if (shader->reload(*vertexCode, *fragmentCode))
+				std::cout << "Hot reload: " << vertexPath << " + " << fragmentPath << std::endl;
+			else
+				std::cout << "Hot reload: " << vertexPath << " + " << fragmentPath << " failed, keeping the old shader" << std::endl;
+		};
+	});
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <memory>
+#include "fileWatcher.h"
+#include "threadPool.h"
+#include "assetRegistry.h"
+#include "..\Shaders\shader.h"
+
+//Reloads assets while the game runs when their files change on disk.
+//A changed OBJ, BMP/PNG or GLSL file is read (and re-cooked) on a worker thread; the GL step
+//that swaps the result in runs from update(), between frames. Meshes and textures are
+//swapped inside the registry's shared objects, so every Mesh and Texture copy sees the new
+//version, and registered shaders are relinked in place under their old id. A file that fails to parse,
+//decode or compile keeps the previous version.
+class HotReloader
+{
+	public:
+		HotReloader(AssetRegistry &registry);
+		~HotReloader();
+
+		void watch(const std::string &directory);
+		//the shader is referenced, it has to outlive the reloader
+		void addShader(Shader &shader, const std::string &vertexPath, const std::string &fragmentPath);
+
+		//layout used when rebuilding meshes, VertexFormat::Packed by default like AssetLoader
+		void setVertexFormat(VertexFormat format);
+
+		//picks up settled file changes and applies finished reloads; call once per frame on the GL thread
+		void update();
+
+	private:
+		struct ShaderEntry
+		{
+			Shader* shader;
+			std::string vertexPath;
+			std::string fragmentPath;
+		};
+
+		void reloadMesh(const std::string &path, std::weak_ptr<MeshGeometry> target);
+		void reloadTexture(const std::string &path, std::weak_ptr<TextureResource> target);
+		void reloadShader(const ShaderEntry &entry);
+		void submit(std::function<std::function<void()>()> job);
+
+		AssetRegistry &registry;
+		VertexFormat vertexFormat;
+		std::vector<ShaderEntry> shaders;
+		FileWatcher watcher;
+
+		std::mutex mutex;
+		std::vector<std::function<void()>> ready;
+		//last, so it finishes its jobs before anything they touch is destroyed
+		ThreadPool pool;
+};
@@ -0,0 +1,148 @@
+#include "levelStreamer.h"
+#include "texturePacker.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+//GL upload time a background prefetch may take out of one frame
+static const double PREFETCH_UPLOAD_BUDGET = 0.002;
+
+LevelManifest& LevelManifest::mesh(Mesh &target, const std::string &path, const std::vector<std::string> &textures)
+{
+	meshes.push_back(MeshEntry{ &target, path, textures });
+	return *this;
+}
+
+LevelManifest& LevelManifest::include(const LevelManifest &other)
+{
+	meshes.insert(meshes.end(), other.meshes.begin(), other.meshes.end());
+	return *this;
+}
+
+const std::vector<LevelManifest::MeshEntry>& LevelManifest::getMeshes() const
+{
+	return meshes;
+}
+
+LevelStreamer::LevelStreamer(AssetRegistry &registry, unsigned int workerCount) : registry(registry), loader(registry, workerCount)
+{
+	current = -1;
+	prefetching = false;
+	peakResidentBytes = 0;
+}
+
+void LevelStreamer::addLevel(int level, const LevelManifest &manifest, int next)
+{
+	manifests[level] = manifest;
+	nextLevels[level] = next;
+}
+
+void LevelStreamer::update(int level)
+{
+	if (level != current)
+	{
+		enter(level);
+		return;
+	}
+
+	if (prefetching && loader.update(PREFETCH_UPLOAD_BUDGET))
+	{
+		prefetching = false;
+		TexturePacker::pack(registry);
+		recordResidency();
+	}
+}
+
+void LevelStreamer::enter(int level)
+{
+	Clock::time_point start = Clock::now();
+
+	//anything the prefetch did not cover (the first level, or a jump to an unexpected one) loads now
+	request(level);
+	loader.finish();
+	prefetching = false;
+
+	current = level;
+	int next = nextLevels.count(level) ? nextLevels[level] : -1;
+	unsigned int evicted = evict(level, next);
+
+	TexturePacker::pack(registry);
+	recordResidency();
+
+	double ms = std::chrono::duration<double>(Clock::now() - start).count() * 1000.0;
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "Level " << level << " ready in " << ms << " ms: " << loaded.size() << " meshes resident, " << evicted << " evicted, "
+		<< registry.getResidentBytes() / 1024.0 << " KB on the GPU (peak " << peakResidentBytes / 1024.0 << " KB)" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+
+	if (next >= 0 && request(next) > 0)
+	{
+		std::cout << "Prefetching level " << next << std::endl;
+		prefetching = true;
+	}
+}
+
+unsigned int LevelStreamer::request(int level)
+{
+	auto manifest = manifests.find(level);
+	if (manifest == manifests.end())
+		return 0;
+
+	unsigned int requested = 0;
+	for (const LevelManifest::MeshEntry &entry : manifest->second.getMeshes())
+	{
+		if (loaded.count(entry.target))
+			continue;
+
+		std::vector<Texture> textures;
+		for (const std::string &texturePath : entry.textures)
+			textures.push_back(loader.loadTexture(texturePath, "texture_diffuse"));
+
+		loader.loadMesh(*entry.target, entry.path, textures);
+		loaded.insert(entry.target);
+		requested++;
+	}
+
+	return requested;
+}
+
+unsigned int LevelStreamer::evict(int level, int next)
+{
+	std::set<Mesh*> keep;
+	for (int kept : { level, next })
+	{
+		auto manifest = manifests.find(kept);
+		if (manifest == manifests.end())
+			continue;
+		for (const LevelManifest::MeshEntry &entry : manifest->second.getMeshes())
+			keep.insert(entry.target);
+	}
+
+	//an empty Mesh drops its geometry and textures, the registry frees them with their last user
+	unsigned int evicted = 0;
+	for (auto it = loaded.begin(); it != loaded.end();)
+	{
+		if (keep.count(*it))
+		{
+			++it;
+			continue;
+		}
+
+		**it = Mesh();
+		it = loaded.erase(it);
+		evicted++;
+	}
+
+	return evicted;
+}
+
+void LevelStreamer::recordResidency()
+{
+	peakResidentBytes = std::max(peakResidentBytes, registry.getResidentBytes());
+}
+
+size_t LevelStreamer::getPeakResidentBytes() const
+{
+	return peakResidentBytes;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <chrono>
+#include "assetLoader.h"
+#include "assetRegistry.h"
+
+//The meshes one level draws and the diffuse textures each of them uses.
+//A mesh can be listed by several levels; it stays loaded across a transition between them.
+class LevelManifest
+{
+	public:
+		struct MeshEntry
+		{
+			Mesh* target;
+			std::string path;
+			std::vector<std::string> textures;
+		};
+
+		//the target is referenced, it has to outlive the LevelStreamer
+		LevelManifest& mesh(Mesh &target, const std::string &path, const std::vector<std::string> &textures);
+		//adds every entry of another manifest, for assets all levels share
+		LevelManifest& include(const LevelManifest &other);
+
+		const std::vector<MeshEntry>& getMeshes() const;
+
+	private:
+		std::vector<MeshEntry> meshes;
+};
+
+//Keeps only the assets of the current level and the one after it resident.
+//On a level change the new level's assets are finished (they are normally already
+//prefetched), every mesh neither level lists is emptied so the registry releases its
+//GPU objects, and the next level starts loading on the worker threads. Its GL uploads
+//run from update() under a small time budget while the current level is played.
+class LevelStreamer
+{
+	public:
+		LevelStreamer(AssetRegistry &registry, unsigned int workerCount);
+
+		//next is the level loaded in the background while this one runs, -1 for none
+		void addLevel(int level, const LevelManifest &manifest, int next = -1);
+
+		//call once per frame from the GL thread with the level being played
+		void update(int level);
+
+		size_t getPeakResidentBytes() const;
+
+	private:
+		typedef std::chrono::high_resolution_clock Clock;
+
+		void enter(int level);
+		//starts loading every mesh of the level that is not loaded yet, returns how many were requested
+		unsigned int request(int level);
+		unsigned int evict(int level, int next);
+		void recordResidency();
+
+		AssetRegistry &registry;
+		AssetLoader loader;
+		std::map<int, LevelManifest> manifests;
+		std::map<int, int> nextLevels;
+		std::set<Mesh*> loaded;
+
+		int current;
+		bool prefetching;
+		size_t peakResidentBytes;
+};
@@ -0,0 +1,88 @@
+#include "texturePacker.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+unsigned int TexturePacker::pack(AssetRegistry &registry)
+{
+	if (!GLEW_ARB_copy_image || !GLEW_ARB_texture_storage)
+	{
+		std::cout << "Texture arrays: no ARB_copy_image / ARB_texture_storage, textures stay separate" << std::endl;
+		return 0;
+	}
+
+	GLint maxLayers = 256;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+	//group by everything a layer has to have in common with its array
+	typedef std::tuple<GLenum, unsigned int, unsigned int, unsigned int> Shape;
+	std::map<Shape, std::vector<std::shared_ptr<TextureResource>>> groups;
+	for (const std::shared_ptr<TextureResource> &texture : registry.getTextures())
+	{
+		if (texture->target != GL_TEXTURE_2D || texture->id == 0 || texture->levelCount == 0)
+			continue;
+		groups[Shape(texture->internalFormat, texture->width, texture->height, texture->levelCount)].push_back(texture);
+	}
+
+	unsigned int packed = 0, arrays = 0;
+
+	for (auto &group : groups)
+	{
+		std::vector<std::shared_ptr<TextureResource>> &members = group.second;
+
+		for (size_t first = 0; first + 1 < members.size(); first += maxLayers)
+		{
+			GLsizei layers = (GLsizei)std::min(members.size() - first, (size_t)maxLayers);
+			if (layers < 2)
+				break;
+
+			const TextureResource &shape = *members[first];
+
+			std::shared_ptr<TextureResource> array = std::make_shared<TextureResource>();
+			glGenTextures(1, &array->id);
+			array->target = GL_TEXTURE_2D_ARRAY;
+			array->internalFormat = shape.internalFormat;
+			array->width = shape.width;
+			array->height = shape.height;
+			array->levelCount = shape.levelCount;
+
+			glBindTexture(GL_TEXTURE_2D_ARRAY, array->id);
+			glTexStorage3D(GL_TEXTURE_2D_ARRAY, shape.levelCount, shape.internalFormat, shape.width, shape.height, layers);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+			for (GLsizei layer = 0; layer < layers; layer++)
+			{
+				TextureResource &texture = *members[first + layer];
+
+				unsigned int width = texture.width, height = texture.height;
+				for (unsigned int level = 0; level < texture.levelCount; level++)
+				{
+					glCopyImageSubData(texture.id, GL_TEXTURE_2D, level, 0, 0, 0,
+						array->id, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+						width, height, 1);
+					width = std::max(1u, width / 2);
+					height = std::max(1u, height / 2);
+				}
+
+				//the 2D original is not needed anymore, the resource now names its layer
+				glDeleteTextures(1, &texture.id);
+				texture.id = array->id;
+				texture.target = GL_TEXTURE_2D_ARRAY;
+				texture.layer = layer;
+				texture.array = array;
+			}
+
+			packed += layers;
+			arrays++;
+			std::cout << "Texture array " << shape.width << "x" << shape.height << ": " << layers << " layers" << std::endl;
+		}
+	}
+
+	std::cout << "Texture arrays: " << packed << " textures packed into " << arrays << " arrays" << std::endl;
+	return packed;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "assetRegistry.h"
+
+//Packs registry textures that share an internal format, size and mip count into
+//GL_TEXTURE_2D_ARRAY layers, so meshes using any of them sample one texture object
+//and only differ by a layer index (the groundwork for batching different meshes in one draw).
+//The levels are copied on the GPU with glCopyImageSubData, the cooked data is not read again.
+//Textures without a partner of the same shape stay plain GL_TEXTURE_2D.
+class TexturePacker
+{
+	public:
+		//returns how many textures were moved into arrays
+		static unsigned int pack(AssetRegistry &registry);
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+//Fixed set of worker threads pulling jobs from a shared FIFO queue.
+//The destructor finishes the queued jobs before joining the workers.
+class ThreadPool
+{
+	public:
+		ThreadPool(unsigned int threadCount);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		void enqueue(std::function<void()> job);
+		unsigned int getThreadCount() const;
+
+	private:
+		void workerLoop();
+
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> jobs;
+		std::mutex mutex;
+		std::condition_variable wake;
+		bool stopping;
+};
@@ -0,0 +1,155 @@
+#include "vfs.h"
+#include "assetPack.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace
+{
+	std::vector<std::unique_ptr<AssetPack>> packs;
+	std::mutex looseMutex;
+	std::set<std::string> loosePaths;
+	std::atomic<unsigned int> packReads(0);
+	std::atomic<unsigned int> looseReads(0);
+}
+
+bool Vfs::mount(const std::string &packPath)
+{
+	std::unique_ptr<AssetPack> pack(new AssetPack());
+	if (!pack->open(packPath))
+		return false;
+
+	std::cout << "Mounted " << packPath << " (" << pack->getEntryCount() << " files)" << std::endl;
+	packs.push_back(std::move(pack));
+	return true;
+}
+
+void Vfs::unmountAll()
+{
+	packs.clear();
+}
+
+void Vfs::preferLoose(const std::string &path)
+{
+	std::lock_guard<std::mutex> lock(looseMutex);
+	loosePaths.insert(normalize(path));
+}
+
+std::string Vfs::normalize(const std::string &path)
+{
+	//pack names always use forward slashes, whichever separator the caller used
+	std::string name = path;
+	std::replace(name.begin(), name.end(), '\\', '/');
+	return std::filesystem::path(name).lexically_normal().generic_string();
+}
+
+unsigned int Vfs::getPackReads()
+{
+	return packReads;
+}
+
+unsigned int Vfs::getLooseReads()
+{
+	return looseReads;
+}
+
+VfsFile::VfsFile()
+{
+	bytes = nullptr;
+	length = 0;
+	opened = false;
+	packed = false;
+}
+
+VfsFile::VfsFile(const std::string &path) : VfsFile()
+{
+	open(path);
+}
+
+bool VfsFile::open(const std::string &path)
+{
+	close();
+
+	if (!packs.empty())
+	{
+		std::string name = Vfs::normalize(path);
+
+		bool loosePreferred;
+		{
+			std::lock_guard<std::mutex> lock(looseMutex);
+			loosePreferred = loosePaths.count(name) != 0;
+		}
+
+		//an edited file is read from disk, the packed copy only stands in if it went missing
+		if (loosePreferred && openLoose(path))
+			return true;
+
+		for (const std::unique_ptr<AssetPack> &pack : packs)
+		{
+			if (pack->find(name, bytes, length))
+			{
+				opened = true;
+				packed = true;
+				packReads++;
+				return true;
+			}
+		}
+
+		if (loosePreferred)
+			return false;
+	}
+
+	//development fallback: the file on disk
+	return openLoose(path);
+}
+
+bool VfsFile::openLoose(const std::string &path)
+{
+	if (!loose.open(path))
+		return false;
+
+	bytes = loose.data();
+	length = loose.size();
+	opened = true;
+	looseReads++;
+	return true;
+}
+
+void VfsFile::close()
+{
+	loose.close();
+	bytes = nullptr;
+	length = 0;
+	opened = false;
+	packed = false;
+}
+
+bool VfsFile::isOpen() const
+{
+	return opened;
+}
+
+bool VfsFile::isPacked() const
+{
+	return packed;
+}
+
+const char* VfsFile::data() const
+{
+	return bytes;
+}
+
+const char* VfsFile::end() const
+{
+	return bytes + length;
+}
+
+size_t VfsFile::size() const
+{
+	return length;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include "..\Model Loading\mappedFile.h"
+
+//Read-only virtual filesystem in front of every asset read.
+//Paths are looked up in the mounted AssetPacks first, then opened as loose files, so a
+//development tree without a pack behaves exactly as before. Paths the hot reloader
+//reports as edited are read loose from then on. Mount before the loaders start;
+//lookups are safe from any thread.
+class Vfs
+{
+	public:
+		static bool mount(const std::string &packPath);
+		static void unmountAll();
+
+		//an edited loose file wins over its packed copy for the rest of the session
+		static void preferLoose(const std::string &path);
+
+		static std::string normalize(const std::string &path);
+
+		static unsigned int getPackReads();
+		static unsigned int getLooseReads();
+};
+
+//A file opened through the Vfs, either a view into a mapped pack or a mapped loose file.
+//Same interface as MappedFile; the bytes stay valid until it is closed or destroyed.
+class VfsFile
+{
+	public:
+		VfsFile();
+		VfsFile(const std::string &path);
+
+		VfsFile(const VfsFile&) = delete;
+		VfsFile& operator=(const VfsFile&) = delete;
+
+		bool open(const std::string &path);
+		void close();
+
+		bool isOpen() const;
+		bool isPacked() const;
+		const char* data() const;
+		const char* end() const;
+		size_t size() const;
+
+	private:
+		bool openLoose(const std::string &path);
+
+		MappedFile loose;
+		const char* bytes;
+		size_t length;
+		bool opened;
+		bool packed;
+};
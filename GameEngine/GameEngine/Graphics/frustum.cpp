@@ -0,0 +1,134 @@
+#include "frustum.h"
+#include <algorithm>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE
+#endif
+
+Frustum::Frustum(const glm::mat4 &viewProjection)
+{
+	//glm is column major, row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+	planes[0] = rows[3] + rows[0];	//left
+	planes[1] = rows[3] - rows[0];	//right
+	planes[2] = rows[3] + rows[1];	//bottom
+	planes[3] = rows[3] - rows[1];	//top
+	planes[4] = rows[3] + rows[2];	//near
+	planes[5] = rows[3] - rows[2];	//far
+
+	for (glm::vec4 &plane : planes)
+		plane /= glm::length(glm::vec3(plane));
+}
+
+bool Frustum::intersects(const glm::vec3 &center, float radius) const
+{
+	for (const glm::vec4 &plane : planes)
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+
+	return true;
+}
+
+void Frustum::intersects(const float* x, const float* y, const float* z, const float* radius, size_t count, unsigned char* visible) const
+{
+	size_t i = 0;
+
+#ifdef FRUSTUM_SSE
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm_set1_ps(planes[p].x);
+		planeY[p] = _mm_set1_ps(planes[p].y);
+		planeZ[p] = _mm_set1_ps(planes[p].z);
+		planeW[p] = _mm_set1_ps(planes[p].w);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(x + i);
+		__m128 cy = _mm_loadu_ps(y + i);
+		__m128 cz = _mm_loadu_ps(z + i);
+		__m128 negativeRadius = _mm_sub_ps(zero, _mm_loadu_ps(radius + i));
+
+		//a sphere is out once it lies entirely behind any one plane
+		__m128 outside = zero;
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+		}
+
+		int mask = _mm_movemask_ps(outside);
+		for (int lane = 0; lane < 4; lane++)
+			visible[i + lane] = (mask >> lane) & 1 ? 0 : 1;
+	}
+#endif
+
+	for (; i < count; i++)
+		visible[i] = intersects(glm::vec3(x[i], y[i], z[i]), radius[i]) ? 1 : 0;
+}
+
+CullBatch::CullBatch()
+{
+	culledCount = 0;
+}
+
+void CullBatch::begin()
+{
+	objects.clear();
+	x.clear();
+	y.clear();
+	z.clear();
+	radius.clear();
+}
+
+void CullBatch::add(Mesh &mesh, const glm::mat4 &model)
+{
+	if (!mesh.geometry)
+		return;
+
+	//the largest axis scale keeps the sphere conservative under non uniform scaling
+	float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	glm::vec4 center = model * glm::vec4(mesh.geometry->boundsCenter, 1.0f);
+
+	objects.push_back(Object{ &mesh, model });
+	x.push_back(center.x);
+	y.push_back(center.y);
+	z.push_back(center.z);
+	radius.push_back(mesh.geometry->boundsRadius * scale);
+}
+
+void CullBatch::cull(const Frustum &frustum)
+{
+	flags.resize(objects.size());
+	visible.clear();
+
+	if (!objects.empty())
+		frustum.intersects(&x[0], &y[0], &z[0], &radius[0], objects.size(), &flags[0]);
+
+	for (size_t i = 0; i < objects.size(); i++)
+		if (flags[i])
+			visible.push_back(objects[i]);
+
+	culledCount = (unsigned int)(objects.size() - visible.size());
+}
+
+const std::vector<CullBatch::Object>& CullBatch::getVisible() const
+{
+	return visible;
+}
+
+unsigned int CullBatch::getVisibleCount() const
+{
+	return (unsigned int)visible.size();
+}
+
+unsigned int CullBatch::getCulledCount() const
+{
+	return culledCount;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <glm.hpp>
+#include <vector>
+#include "..\Model Loading\mesh.h"
+
+//The six planes of a view frustum, taken from a view-projection matrix (Gribb/Hartmann).
+//Normals point inwards and are normalized, so a plane returns signed distances.
+class Frustum
+{
+	public:
+		explicit Frustum(const glm::mat4 &viewProjection);
+
+		bool intersects(const glm::vec3 &center, float radius) const;
+		//tests count spheres stored as separate x, y, z and radius arrays, four per SSE iteration;
+		//visible[i] becomes 1 for spheres at least partly inside, 0 for the rest
+		void intersects(const float* x, const float* y, const float* z, const float* radius, size_t count, unsigned char* visible) const;
+
+	private:
+		glm::vec4 planes[6];
+};
+
+//Objects of one frame waiting for the visibility test. Their world space bounding
+//spheres are kept in structure-of-arrays form so the frustum test runs on all of them at once.
+class CullBatch
+{
+	public:
+		struct Object
+		{
+			Mesh* mesh;
+			glm::mat4 model;
+		};
+
+		CullBatch();
+
+		//drops the last frame's objects, the storage is kept
+		void begin();
+		//meshes without geometry are ignored
+		void add(Mesh &mesh, const glm::mat4 &model);
+		//keeps the objects that touch the frustum, in the order they were added
+		void cull(const Frustum &frustum);
+
+		const std::vector<Object>& getVisible() const;
+		//objects kept and rejected by the last cull()
+		unsigned int getVisibleCount() const;
+		unsigned int getCulledCount() const;
+
+	private:
+		std::vector<Object> objects;
+		std::vector<Object> visible;
+		std::vector<float> x, y, z, radius;
+		std::vector<unsigned char> flags;
+
+		unsigned int culledCount;
+};
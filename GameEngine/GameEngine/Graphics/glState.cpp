@@ -0,0 +1,138 @@
+#include "glState.h"
+
+static const GLenum TRACKED_CAP_NAMES[] = { GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_SCISSOR_TEST };
+
+GLState &GLState::shared()
+{
+	static GLState state;
+	return state;
+}
+
+GLState::GLState()
+{
+	issuedCalls = 0;
+	skippedCalls = 0;
+	invalidate();
+}
+
+void GLState::useProgram(GLuint program)
+{
+	if (this->program == program)
+	{
+		skippedCalls++;
+		return;
+	}
+
+	glUseProgram(program);
+	this->program = program;
+	issuedCalls++;
+}
+
+void GLState::bindVertexArray(GLuint vertexArray)
+{
+	if (this->vertexArray == vertexArray)
+	{
+		skippedCalls++;
+		return;
+	}
+
+	glBindVertexArray(vertexArray);
+	this->vertexArray = vertexArray;
+	issuedCalls++;
+}
+
+void GLState::bindTexture(unsigned int unit, GLenum target, GLuint texture)
+{
+	int slot = target == GL_TEXTURE_2D ? 0 : (target == GL_TEXTURE_2D_ARRAY ? 1 : -1);
+
+	if (unit < MAX_TEXTURE_UNITS && slot >= 0 && textures[unit][slot] == texture)
+	{
+		skippedCalls++;
+		return;
+	}
+
+	activeTexture(unit);
+	glBindTexture(target, texture);
+	issuedCalls++;
+
+	if (unit < MAX_TEXTURE_UNITS && slot >= 0)
+		textures[unit][slot] = texture;
+}
+
+void GLState::enable(GLenum cap)
+{
+	setCap(cap, true);
+}
+
+void GLState::disable(GLenum cap)
+{
+	setCap(cap, false);
+}
+
+void GLState::setCap(GLenum cap, bool on)
+{
+	unsigned int index = 0;
+	while (index < TRACKED_CAPS && TRACKED_CAP_NAMES[index] != cap)
+		index++;
+
+	if (index < TRACKED_CAPS && caps[index] == (GLuint)on)
+	{
+		skippedCalls++;
+		return;
+	}
+
+	if (on)
+		glEnable(cap);
+	else
+		glDisable(cap);
+	issuedCalls++;
+
+	if (index < TRACKED_CAPS)
+		caps[index] = (GLuint)on;
+}
+
+void GLState::activeTexture(unsigned int unit)
+{
+	if (activeUnit == unit)
+		return;
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	activeUnit = unit;
+	issuedCalls++;
+}
+
+void GLState::reset()
+{
+	bindVertexArray(0);
+	activeTexture(0);
+	invalidate();
+}
+
+void GLState::invalidate()
+{
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	activeUnit = UNKNOWN;
+
+	for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+		textures[unit][0] = textures[unit][1] = UNKNOWN;
+
+	for (unsigned int i = 0; i < TRACKED_CAPS; i++)
+		caps[i] = UNKNOWN;
+}
+
+unsigned int GLState::getIssuedCalls() const
+{
+	return issuedCalls;
+}
+
+unsigned int GLState::getSkippedCalls() const
+{
+	return skippedCalls;
+}
+
+void GLState::resetStats()
+{
+	issuedCalls = 0;
+	skippedCalls = 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <glew.h>
+
+//Shadow copy of the GL binding state the renderer touches per draw: the program, the
+//vertex array, the texture bound to each unit and a few enable bits. Requests that would
+//not change anything are dropped before they reach the driver, and both kinds are counted.
+//GL code that binds outside the tracker (uploads, texture packing, ImGui) runs after reset(),
+//which puts the defaults back and forgets everything. GL thread only.
+class GLState
+{
+	public:
+		static const unsigned int MAX_TEXTURE_UNITS = 16;
+
+		static GLState &shared();
+
+		void useProgram(GLuint program);
+		void bindVertexArray(GLuint vertexArray);
+		//GL_TEXTURE_2D and GL_TEXTURE_2D_ARRAY are tracked per unit, other targets always bind
+		void bindTexture(unsigned int unit, GLenum target, GLuint texture);
+		//GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE and GL_SCISSOR_TEST are tracked, other caps always go through
+		void enable(GLenum cap);
+		void disable(GLenum cap);
+
+		//binds vertex array 0 and texture unit 0 again and forgets the rest
+		void reset();
+		//forgets everything without issuing anything
+		void invalidate();
+
+		//GL calls made and requests dropped as redundant since the last resetStats()
+		unsigned int getIssuedCalls() const;
+		unsigned int getSkippedCalls() const;
+		void resetStats();
+
+	private:
+		GLState();
+
+		GLState(const GLState&) = delete;
+		GLState& operator=(const GLState&) = delete;
+
+		void activeTexture(unsigned int unit);
+		void setCap(GLenum cap, bool on);
+
+		static const GLuint UNKNOWN = 0xFFFFFFFFu;
+		static const unsigned int TRACKED_CAPS = 4;
+
+		GLuint program;
+		GLuint vertexArray;
+		GLuint activeUnit;
+		GLuint textures[MAX_TEXTURE_UNITS][2];
+		GLuint caps[TRACKED_CAPS];
+
+		unsigned int issuedCalls;
+		unsigned int skippedCalls;
+};
@@ -0,0 +1,118 @@
+#include "instanceBatch.h"
+#include <algorithm>
+
+InstanceBatch::InstanceBatch()
+{
+	buffer = 0;
+	bufferSize = 0;
+	instanceCount = 0;
+	drawCount = 0;
+}
+
+InstanceBatch::~InstanceBatch()
+{
+	if (buffer != 0)
+		glDeleteBuffers(1, &buffer);
+}
+
+void InstanceBatch::begin()
+{
+	for (size_t index : order)
+		batches[index].instances.clear();
+	order.clear();
+}
+
+void InstanceBatch::add(Mesh &mesh, const glm::mat4 &model, unsigned int lod)
+{
+	std::pair<Mesh*, unsigned int> key(&mesh, lod);
+	auto found = batchIndex.find(key);
+	if (found == batchIndex.end())
+	{
+		found = batchIndex.emplace(key, batches.size()).first;
+		batches.push_back(Batch{ &mesh, lod, std::vector<MeshInstance>() });
+	}
+
+	Batch &batch = batches[found->second];
+	if (batch.instances.empty())
+		order.push_back(found->second);
+	batch.instances.push_back(MeshInstance(model));
+}
+
+void InstanceBatch::draw(Shader &shader, const glm::mat4 &viewProjection)
+{
+	static const Shader::Uniform viewProjectionUniform = Shader::uniform("viewProjection");
+	static const Shader::Uniform mvpUniform = Shader::uniform("MVP");
+	static const Shader::Uniform modelUniform = Shader::uniform("model");
+	static const Shader::Uniform normalMatrixUniform = Shader::uniform("normalMatrix");
+
+	//only batches with several copies go through the instance buffer
+	size_t total = 0;
+	for (size_t index : order)
+		if (batches[index].instances.size() > 1)
+			total += batches[index].instances.size();
+
+	if (total > 0)
+	{
+		if (buffer == 0)
+			glGenBuffers(1, &buffer);
+
+		//orphan the previous storage so the driver never waits for draws still reading it
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		bufferSize = std::max(bufferSize, total * sizeof(MeshInstance));
+		glBufferData(GL_ARRAY_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+
+		size_t offset = 0;
+		for (size_t index : order)
+		{
+			const Batch &batch = batches[index];
+			if (batch.instances.size() < 2)
+				continue;
+
+			size_t bytes = batch.instances.size() * sizeof(MeshInstance);
+			glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, &batch.instances[0]);
+			offset += bytes;
+		}
+
+		shader.set(viewProjectionUniform, viewProjection);
+	}
+
+	size_t offset = 0;
+	for (size_t index : order)
+	{
+		Batch &batch = batches[index];
+		if (batch.instances.size() == 1)
+		{
+			const MeshInstance &instance = batch.instances[0];
+			shader.set(mvpUniform, viewProjection * instance.model);
+			shader.set(modelUniform, instance.model);
+			shader.set(normalMatrixUniform, instance.normalMatrix);
+			batch.mesh->draw(shader, batch.lod);
+		}
+		else
+		{
+			batch.mesh->drawInstanced(shader, batch.lod, buffer, offset, (unsigned int)batch.instances.size());
+			offset += batch.instances.size() * sizeof(MeshInstance);
+		}
+
+		instanceCount += (unsigned int)batch.instances.size();
+		drawCount++;
+	}
+
+	begin();
+}
+
+unsigned int InstanceBatch::getInstanceCount() const
+{
+	return instanceCount;
+}
+
+unsigned int InstanceBatch::getDrawCount() const
+{
+	return drawCount;
+}
+
+void InstanceBatch::resetStats()
+{
+	instanceCount = 0;
+	drawCount = 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <glew.h>
+#include <glm.hpp>
+#include <map>
+#include <vector>
+#include "..\Model Loading\mesh.h"
+#include "..\Shaders\shader.h"
+
+//Collects the model matrices of every copy of a mesh drawn in a frame and renders each
+//(mesh, lod) pair with a single instanced draw, in the order the pairs were first added.
+//The normal matrix of each copy is worked out here once, not per vertex in the shader.
+//All matrices go into one stream buffer that is orphaned and refilled per draw(); a pair
+//with a single copy is drawn plainly through the MVP, model and normalMatrix uniforms instead.
+//Meshes are referenced until draw() and have to stay alive until then. GL thread only.
+class InstanceBatch
+{
+	public:
+		InstanceBatch();
+		~InstanceBatch();
+
+		InstanceBatch(const InstanceBatch&) = delete;
+		InstanceBatch& operator=(const InstanceBatch&) = delete;
+
+		//drops what the last frame queued, the storage is kept
+		void begin();
+		void add(Mesh &mesh, const glm::mat4 &model, unsigned int lod = 0);
+		//uploads the queued matrices and issues one draw call per (mesh, lod), then drops them
+		void draw(Shader &shader, const glm::mat4 &viewProjection);
+
+		//copies and draw calls since the last resetStats()
+		unsigned int getInstanceCount() const;
+		unsigned int getDrawCount() const;
+		void resetStats();
+
+	private:
+		struct Batch
+		{
+			Mesh* mesh;
+			unsigned int lod;
+			std::vector<MeshInstance> instances;
+		};
+
+		//batches are kept between frames so their matrix vectors do not reallocate;
+		//order lists the ones in use by when they were first added
+		std::vector<Batch> batches;
+		std::map<std::pair<Mesh*, unsigned int>, size_t> batchIndex;
+		std::vector<size_t> order;
+
+		GLuint buffer;
+		size_t bufferSize;
+
+		unsigned int instanceCount;
+		unsigned int drawCount;
+};
@@ -0,0 +1,164 @@
+#include "renderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+static const unsigned int DEPTH_BITS = 24;
+static const unsigned int MESH_BITS = 16;
+static const unsigned int MATERIAL_BITS = 16;
+static const unsigned int SHADER_BITS = 6;
+
+static const unsigned int MESH_SHIFT = DEPTH_BITS;
+static const unsigned int MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+static const unsigned int SHADER_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+static const unsigned int PASS_SHIFT = SHADER_SHIFT + SHADER_BITS;
+
+static const uint64_t MATERIAL_MASK = ((uint64_t)1 << MATERIAL_BITS) - 1;
+static const uint64_t MESH_MASK = ((uint64_t)1 << MESH_BITS) - 1;
+static const uint64_t SHADER_MASK = ((uint64_t)1 << SHADER_BITS) - 1;
+
+RenderQueue::RenderQueue()
+{
+	eye = glm::vec3(0.0f);
+	farPlane = 1.0f;
+	packetCount = 0;
+	shaderChanges = 0;
+	materialChanges = 0;
+}
+
+void RenderQueue::begin(const glm::vec3 &eye, float farPlane)
+{
+	this->eye = eye;
+	this->farPlane = farPlane;
+	packets.clear();
+	entries.clear();
+	meshIds.clear();
+}
+
+void RenderQueue::submit(Shader &shader, Mesh &mesh, const glm::mat4 &model, unsigned int lod, RenderPass pass)
+{
+	if (!mesh.geometry)
+		return;
+
+	entries.push_back(SortEntry{ makeKey(shader, mesh, model, pass), (uint32_t)packets.size() });
+	packets.push_back(Packet{ &shader, &mesh, lod, model });
+}
+
+uint64_t RenderQueue::makeKey(Shader &shader, Mesh &mesh, const glm::mat4 &model, RenderPass pass)
+{
+	//distance of the object's origin, quantized over [0, farPlane]
+	glm::vec3 origin(model[3][0], model[3][1], model[3][2]);
+	float distance = glm::length(origin - eye) / farPlane;
+	distance = std::min(std::max(distance, 0.0f), 1.0f);
+
+	const uint64_t depthMax = ((uint64_t)1 << DEPTH_BITS) - 1;
+	uint64_t depth = (uint64_t)(distance * (float)depthMax);
+	if (pass == RenderPass::Transparent)
+		depth = depthMax - depth;
+
+	uint64_t material = mesh.textures.empty() ? 0 : (mesh.textures[0].getId() & MATERIAL_MASK);
+
+	auto id = meshIds.find(mesh.geometry.get());
+	if (id == meshIds.end())
+		id = meshIds.emplace(mesh.geometry.get(), (uint64_t)meshIds.size() & MESH_MASK).first;
+
+	return ((uint64_t)pass << PASS_SHIFT)
+		| (((uint64_t)shader.getId() & SHADER_MASK) << SHADER_SHIFT)
+		| (material << MATERIAL_SHIFT)
+		| (id->second << MESH_SHIFT)
+		| depth;
+}
+
+//LSD radix sort on the key, one byte per pass; stable, so equal keys keep their submission order
+void RenderQueue::sort()
+{
+	scratch.resize(entries.size());
+
+	for (unsigned int shift = 0; shift < 64; shift += 8)
+	{
+		size_t counts[256];
+		memset(counts, 0, sizeof(counts));
+		for (const SortEntry &entry : entries)
+			counts[(entry.key >> shift) & 0xFF]++;
+
+		//every key has the same byte here, the pass would not move anything
+		if (counts[(entries[0].key >> shift) & 0xFF] == entries.size())
+			continue;
+
+		size_t offset = 0;
+		for (size_t &count : counts)
+		{
+			size_t c = count;
+			count = offset;
+			offset += c;
+		}
+
+		for (const SortEntry &entry : entries)
+			scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+
+		entries.swap(scratch);
+	}
+}
+
+void RenderQueue::flush(InstanceBatch &batch, const glm::mat4 &viewProjection)
+{
+	if (entries.empty())
+		return;
+
+	sort();
+
+	//the batch draws per (mesh, lod) in first-seen order, so it is flushed whenever the
+	//program or pass changes to keep those boundaries in key order
+	const uint64_t boundaryMask = ~(((uint64_t)1 << SHADER_SHIFT) - 1);
+	Shader* current = nullptr;
+	uint64_t previousKey = 0;
+
+	batch.begin();
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const SortEntry &entry = entries[i];
+		const Packet &packet = packets[entry.packet];
+
+		if (i > 0 && (entry.key & boundaryMask) != (previousKey & boundaryMask))
+			batch.draw(*current, viewProjection);
+		if (i > 0 && ((entry.key >> MATERIAL_SHIFT) & MATERIAL_MASK) != ((previousKey >> MATERIAL_SHIFT) & MATERIAL_MASK))
+			materialChanges++;
+
+		if (packet.shader != current)
+		{
+			if (current != nullptr)
+				shaderChanges++;
+			current = packet.shader;
+			current->use();
+		}
+
+		batch.add(*packet.mesh, packet.model, packet.lod);
+		previousKey = entry.key;
+	}
+	batch.draw(*current, viewProjection);
+
+	packetCount += (unsigned int)entries.size();
+	packets.clear();
+	entries.clear();
+}
+
+unsigned int RenderQueue::getPacketCount() const
+{
+	return packetCount;
+}
+
+unsigned int RenderQueue::getShaderChanges() const
+{
+	return shaderChanges;
+}
+
+unsigned int RenderQueue::getMaterialChanges() const
+{
+	return materialChanges;
+}
+
+void RenderQueue::resetStats()
+{
+	packetCount = 0;
+	shaderChanges = 0;
+	materialChanges = 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <glm.hpp>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "instanceBatch.h"
+
+//Passes run in this order; within a pass opaque packets go front to back, transparent ones back to front
+enum class RenderPass : unsigned int
+{
+	Opaque = 0,
+	Transparent = 1
+};
+
+//Draw packets submitted during a frame, sorted before anything reaches GL.
+//Each packet gets a 64-bit key, most significant field first:
+//	pass (2 bits) | shader (6) | material (16) | mesh (16) | depth (24)
+//so sorting the keys groups packets by program, then by diffuse texture, then by mesh,
+//and orders equal ones by distance. flush() radix sorts the keys and hands the packets
+//to an InstanceBatch in that order, which also merges copies of the same mesh into one draw.
+class RenderQueue
+{
+	public:
+		RenderQueue();
+
+		//drops the last frame's packets; eye and farPlane scale the depth field
+		void begin(const glm::vec3 &eye, float farPlane);
+		void submit(Shader &shader, Mesh &mesh, const glm::mat4 &model, unsigned int lod = 0, RenderPass pass = RenderPass::Opaque);
+		//sorts and draws everything submitted since begin()
+		void flush(InstanceBatch &batch, const glm::mat4 &viewProjection);
+
+		//packets flushed and shader or texture changes between consecutive ones since the last resetStats()
+		unsigned int getPacketCount() const;
+		unsigned int getShaderChanges() const;
+		unsigned int getMaterialChanges() const;
+		void resetStats();
+
+	private:
+		struct Packet
+		{
+			Shader* shader;
+			Mesh* mesh;
+			unsigned int lod;
+			glm::mat4 model;
+		};
+
+		struct SortEntry
+		{
+			uint64_t key;
+			uint32_t packet;
+		};
+
+		uint64_t makeKey(Shader &shader, Mesh &mesh, const glm::mat4 &model, RenderPass pass);
+		void sort();
+
+		glm::vec3 eye;
+		float farPlane;
+
+		std::vector<Packet> packets;
+		std::vector<SortEntry> entries;
+		std::vector<SortEntry> scratch;
+		//meshes get small ids in the order they are first submitted, pointers are too wide for the key
+		std::map<const MeshGeometry*, uint64_t> meshIds;
+
+		unsigned int packetCount;
+		unsigned int shaderChanges;
+		unsigned int materialChanges;
+};
@@ -0,0 +1,26 @@
+#include "contentHash.h"
+#include <cstring>
+
+uint64_t hashContent(const void* data, size_t size, uint64_t seed)
+{
+	const uint64_t prime = 0x100000001b3ull;
+	const unsigned char* bytes = (const unsigned char*)data;
+
+	uint64_t hash = seed ^ (size * prime);
+
+	//eight bytes per step, then the tail one byte at a time (FNV-1a style mixing)
+	size_t words = size / 8;
+	for (size_t i = 0; i < words; i++)
+	{
+		uint64_t word;
+		memcpy(&word, bytes + i * 8, 8);
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+
+	for (size_t i = words * 8; i < size; i++)
+		hash = (hash ^ bytes[i]) * prime;
+
+	hash ^= hash >> 32;
+	return hash;
+}
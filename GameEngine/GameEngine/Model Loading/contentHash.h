@@ -0,0 +1,7 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+//64-bit hash of a block of bytes, used to tell whether a cooked file still matches its source.
+//Not cryptographic; it only has to change when the content changes.
+uint64_t hashContent(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
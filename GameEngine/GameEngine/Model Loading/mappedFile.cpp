@@ -0,0 +1,148 @@
+#include "mappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	bytes = nullptr;
+	length = 0;
+	opened = false;
+#ifdef _WIN32
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+#endif
+}
+
+MappedFile::MappedFile(const std::string &path) : MappedFile()
+{
+	open(path);
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string &path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	length = (size_t)fileSize.QuadPart;
+	opened = true;
+
+	//an empty file cannot be mapped, but it is still a valid (empty) view
+	if (length == 0)
+		return true;
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		close();
+		return false;
+	}
+	mappingHandle = mapping;
+
+	bytes = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (bytes == nullptr)
+	{
+		close();
+		return false;
+	}
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	length = (size_t)st.st_size;
+	opened = true;
+
+	if (length > 0)
+	{
+		void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view == MAP_FAILED)
+		{
+			::close(fd);
+			length = 0;
+			opened = false;
+			return false;
+		}
+		madvise(view, length, MADV_SEQUENTIAL);
+		bytes = (const char*)view;
+	}
+
+	//the mapping keeps its own reference to the file
+	::close(fd);
+#endif
+
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (bytes != nullptr)
+		UnmapViewOfFile(bytes);
+	if (mappingHandle != nullptr)
+		CloseHandle((HANDLE)mappingHandle);
+	if (fileHandle != nullptr)
+		CloseHandle((HANDLE)fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (bytes != nullptr)
+		munmap((void*)bytes, length);
+#endif
+
+	bytes = nullptr;
+	length = 0;
+	opened = false;
+}
+
+bool MappedFile::isOpen() const
+{
+	return opened;
+}
+
+const char* MappedFile::data() const
+{
+	return bytes;
+}
+
+const char* MappedFile::end() const
+{
+	return bytes + length;
+}
+
+size_t MappedFile::size() const
+{
+	return length;
+}
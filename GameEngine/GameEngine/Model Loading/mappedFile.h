@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+//Read-only view of a whole file mapped into memory.
+//The bytes stay valid until the MappedFile is closed or destroyed.
+class MappedFile
+{
+	public:
+		MappedFile();
+		MappedFile(const std::string &path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::string &path);
+		void close();
+
+		bool isOpen() const;
+		const char* data() const;
+		const char* end() const;
+		size_t size() const;
+
+	private:
+		const char* bytes;
+		size_t length;
+		bool opened;
+
+#ifdef _WIN32
+		void* fileHandle;
+		void* mappingHandle;
+#endif
+};
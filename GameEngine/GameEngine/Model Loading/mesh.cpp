@@ -1,110 +1,556 @@
 #include "mesh.h"
+#include "..\Graphics\glState.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 
-Mesh::Mesh() {}
+namespace
+{
+	//Cuts a level into runs of triangles whose vertices lie within 65536 of the run's lowest one
+	//and writes their indices relative to it. False if one triangle alone spans more than that.
+	bool splitForShortIndices(const int* indices, const MeshLod &lod, std::vector<MeshSubmesh> &submeshes, std::vector<unsigned short> &shortIndices)
+	{
+		const unsigned int range = 65536;
+		unsigned int begin = lod.indexOffset, end = lod.indexOffset + lod.indexCount;
+		unsigned int runBegin = begin;
+		int runMin = 0, runMax = -1;
+
+		submeshes.clear();
+
+		for (unsigned int i = begin; i + 2 < end; i += 3)
+		{
+			int a = lod.vertexOffset + indices[i], b = lod.vertexOffset + indices[i + 1], c = lod.vertexOffset + indices[i + 2];
+			int triangleMin = std::min(a, std::min(b, c)), triangleMax = std::max(a, std::max(b, c));
+			if ((unsigned int)(triangleMax - triangleMin) >= range)
+				return false;
+
+			if (runMax < runMin)
+			{
+				runMin = triangleMin;
+				runMax = triangleMax;
+			}
+			else if ((unsigned int)(std::max(runMax, triangleMax) - std::min(runMin, triangleMin)) >= range)
+			{
+				submeshes.push_back(MeshSubmesh{ runBegin, i - runBegin, runMin });
+				runBegin = i;
+				runMin = triangleMin;
+				runMax = triangleMax;
+			}
+			else
+			{
+				runMin = std::min(runMin, triangleMin);
+				runMax = std::max(runMax, triangleMax);
+			}
+		}
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<int> indices)
+		if (end > runBegin)
+			submeshes.push_back(MeshSubmesh{ runBegin, end - runBegin, runMax < runMin ? (int)lod.vertexOffset : runMin });
+
+		for (const MeshSubmesh &submesh : submeshes)
+			for (unsigned int i = submesh.indexOffset; i < submesh.indexOffset + submesh.indexCount; i++)
+				shortIndices[i] = (unsigned short)(lod.vertexOffset + indices[i] - submesh.baseVertex);
+
+		return true;
+	}
+}
+
+MeshGeometry::MeshGeometry()
 {
-	this->vertices = vertices;
-	this->indices = indices;
+	vao = vbo = ibo = 0;
+	indexCount = 0;
+	residentBytes = 0;
+	indexType = GL_UNSIGNED_INT;
+	indexSize = sizeof(unsigned int);
+	keepCpuData = false;
+	format = VertexFormat::Float;
+	positionScale = glm::vec3(1.0f);
+	boundsCenter = glm::vec3(0.0f);
+	boundsRadius = 0.0f;
+}
 
-	setup2();
+MeshGeometry::MeshGeometry(MeshGeometry &&other) : MeshGeometry()
+{
+	*this = std::move(other);
 }
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<int> indices, std::vector<Texture> textures)
+MeshGeometry& MeshGeometry::operator=(MeshGeometry &&other)
+{
+	if (this == &other)
+		return *this;
+
+	release();
+
+	vao = other.vao;
+	vbo = other.vbo;
+	ibo = other.ibo;
+	indexCount = other.indexCount;
+	residentBytes = other.residentBytes;
+	boundsMin = other.boundsMin;
+	boundsMax = other.boundsMax;
+	boundsCenter = other.boundsCenter;
+	boundsRadius = other.boundsRadius;
+	format = other.format;
+	positionOffset = other.positionOffset;
+	positionScale = other.positionScale;
+	keepCpuData = other.keepCpuData;
+	vertices = std::move(other.vertices);
+	indices = std::move(other.indices);
+	lods = std::move(other.lods);
+	indexType = other.indexType;
+	indexSize = other.indexSize;
+	submeshes = std::move(other.submeshes);
+
+	//the other geometry no longer owns the GL objects
+	other.vao = other.vbo = other.ibo = 0;
+	other.indexCount = 0;
+	other.residentBytes = 0;
+
+	return *this;
+}
+
+MeshGeometry::~MeshGeometry()
+{
+	release();
+}
+
+void MeshGeometry::release()
+{
+	if (vao != 0) glDeleteVertexArrays(1, &vao);
+	if (vbo != 0) glDeleteBuffers(1, &vbo);
+	if (ibo != 0) glDeleteBuffers(1, &ibo);
+
+	vao = vbo = ibo = 0;
+	indexCount = 0;
+	residentBytes = 0;
+	vertices = std::vector<Vertex>();
+	indices = std::vector<int>();
+	lods.clear();
+	submeshes.clear();
+}
+
+bool MeshGeometry::isUploaded() const
+{
+	return vao != 0;
+}
+
+size_t MeshGeometry::getCpuBytes() const
+{
+	return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(int);
+}
+
+MeshBuilder::MeshBuilder()
+{
+	vertices = nullptr;
+	vertexCount = 0;
+	indices = nullptr;
+	indexCount = 0;
+	positionsOnly = false;
+	residency = MeshResidency::GpuOnly;
+	format = VertexFormat::Float;
+	lods = nullptr;
+	lodCount = 0;
+}
+
+MeshBuilder& MeshBuilder::setVertices(const Vertex* vertices, unsigned int count)
 {
 	this->vertices = vertices;
+	this->vertexCount = count;
+	return *this;
+}
+
+MeshBuilder& MeshBuilder::setIndices(const int* indices, unsigned int count)
+{
 	this->indices = indices;
-	this->textures = textures;
+	this->indexCount = count;
+	return *this;
+}
 
-	setup();
+MeshBuilder& MeshBuilder::setPositionsOnly(bool positionsOnly)
+{
+	this->positionsOnly = positionsOnly;
+	return *this;
 }
 
-// render the mesh
-void Mesh::draw(Shader shader)
+MeshBuilder& MeshBuilder::setResidency(MeshResidency residency)
 {
-	unsigned int diffuseNr = 1;
-	unsigned int specularNr = 1;
-	unsigned int normalNr = 1;
-	unsigned int heightNr = 1;
+	this->residency = residency;
+	return *this;
+}
 
-	for (unsigned int i = 0; i < textures.size(); i++)
+MeshBuilder& MeshBuilder::setVertexFormat(VertexFormat format)
+{
+	this->format = format;
+	return *this;
+}
+
+MeshBuilder& MeshBuilder::setLods(const MeshLod* lods, unsigned int count)
+{
+	this->lods = lods;
+	this->lodCount = count;
+	return *this;
+}
+
+bool MeshBuilder::canPack(const Vertex* vertices, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		if (glm::abs(vertices[i].textureCoords.x) > 2.0f || glm::abs(vertices[i].textureCoords.y) > 2.0f)
+			return false;
+
+	return true;
+}
+
+PackedVertex MeshBuilder::pack(const Vertex &vertex, glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+	PackedVertex packed;
+
+	glm::vec3 extent = boundsMax - boundsMin;
+	for (int axis = 0; axis < 3; axis++)
 	{
-		glActiveTexture(GL_TEXTURE0 + i); 
-											
-		std::string number;
-		std::string name = textures[i].type;
-		if (name == "texture_diffuse")
-			number = std::to_string(diffuseNr++);
-		else if (name == "texture_specular")
-			number = std::to_string(specularNr++); 
-		else if (name == "texture_normal")
-			number = std::to_string(normalNr++);
-		else if (name == "texture_height")
-			number = std::to_string(heightNr++); 
+		float t = extent[axis] > 0.0f ? (vertex.pos[axis] - boundsMin[axis]) / extent[axis] : 0.0f;
+		packed.pos[axis] = (unsigned short)(glm::clamp(t, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	}
+	packed.pos[3] = 0;
 
-		glUniform1i(glGetUniformLocation(shader.getId(), (name + number).c_str()), i);
-		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+	//x in the low bits, w left at zero
+	packed.normals = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		int component = (int)glm::floor(glm::clamp(vertex.normals[axis], -1.0f, 1.0f) * 511.0f + 0.5f);
+		packed.normals |= ((unsigned int)component & 0x3FFu) << (axis * 10);
 	}
 
-	glBindVertexArray(vao);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
+	packed.textureCoords = glm::packHalf2x16(vertex.textureCoords);
 
-	glActiveTexture(GL_TEXTURE0);
+	return packed;
 }
 
-void Mesh::setup()
+MeshGeometry MeshBuilder::build() const
 {
+	MeshGeometry geometry;
+	geometry.indexCount = indexCount;
+
+	if (lodCount > 0)
+		geometry.lods.assign(lods, lods + lodCount);
+	else
+		geometry.lods.push_back(MeshLod{ 0, indexCount, 0, vertexCount });
+
+	//16-bit indices whenever every triangle fits in one 65536 vertex window
+	std::vector<unsigned short> shortIndices(indexCount);
+	geometry.submeshes.resize(geometry.lods.size());
+	bool shortFits = true;
+	for (size_t lod = 0; lod < geometry.lods.size() && shortFits; lod++)
+		shortFits = splitForShortIndices(indices, geometry.lods[lod], geometry.submeshes[lod], shortIndices);
+
+	if (shortFits)
+	{
+		geometry.indexType = GL_UNSIGNED_SHORT;
+		geometry.indexSize = sizeof(unsigned short);
+	}
+	else
+	{
+		shortIndices = std::vector<unsigned short>();
+		for (size_t lod = 0; lod < geometry.lods.size(); lod++)
+			geometry.submeshes[lod].assign(1, MeshSubmesh{ geometry.lods[lod].indexOffset, geometry.lods[lod].indexCount, (int)geometry.lods[lod].vertexOffset });
+	}
+
+	geometry.residentBytes = vertexCount * sizeof(Vertex) + indexCount * geometry.indexSize;
+
+	geometry.boundsMin = geometry.boundsMax = vertexCount > 0 ? vertices[0].pos : glm::vec3(0.0f);
+	for (unsigned int i = 1; i < vertexCount; i++)
+	{
+		geometry.boundsMin = glm::min(geometry.boundsMin, vertices[i].pos);
+		geometry.boundsMax = glm::max(geometry.boundsMax, vertices[i].pos);
+	}
+
+	//tighter than half the box diagonal for anything that does not fill its corners
+	geometry.boundsCenter = (geometry.boundsMin + geometry.boundsMax) * 0.5f;
+	float radiusSquared = 0.0f;
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		glm::vec3 d = vertices[i].pos - geometry.boundsCenter;
+		radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+	}
+	geometry.boundsRadius = std::sqrt(radiusSquared);
+
+	geometry.keepCpuData = residency == MeshResidency::KeepCpuData;
+	if (geometry.keepCpuData)
+	{
+		geometry.vertices.assign(vertices, vertices + vertexCount);
+		geometry.indices.assign(indices, indices + indexCount);
+	}
+
+	geometry.format = (format == VertexFormat::Packed && canPack(vertices, vertexCount)) ? VertexFormat::Packed : VertexFormat::Float;
+
 	//create buffers
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
-	glGenBuffers(1, &ibo);
+	glGenVertexArrays(1, &geometry.vao);
+	glGenBuffers(1, &geometry.vbo);
+	glGenBuffers(1, &geometry.ibo);
 
 	//bind buffers
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+	glBindVertexArray(geometry.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, geometry.vbo);
+
+	if (geometry.format == VertexFormat::Packed)
+	{
+		std::vector<PackedVertex> packed(vertexCount);
+		for (unsigned int i = 0; i < vertexCount; i++)
+			packed[i] = pack(vertices[i], geometry.boundsMin, geometry.boundsMax);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		geometry.positionOffset = geometry.boundsMin;
+		geometry.positionScale = geometry.boundsMax - geometry.boundsMin;
+		geometry.residentBytes = vertexCount * sizeof(PackedVertex) + indexCount * geometry.indexSize;
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+	}
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.ibo);
+	if (geometry.indexType == GL_UNSIGNED_SHORT)
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned short), shortIndices.data(), GL_STATIC_DRAW);
+	else
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+
+	if (geometry.format == VertexFormat::Packed)
+	{
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, pos));
 
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normals));
+		if (!positionsOnly)
+		{
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normals));
 
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, textureCoords));
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, textureCoords));
+		}
+	}
+	else
+	{
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+
+		//no textures yet
+		if (!positionsOnly)
+		{
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normals));
+
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, textureCoords));
+		}
+	}
 
 	glBindVertexArray(0);
+
+	return geometry;
 }
 
-//no textures yet
-void Mesh::setup2()
+Mesh::Mesh() {}
+
+Mesh::Mesh(const std::vector<Vertex> &vertices, const std::vector<int> &indices, MeshResidency residency)
+	: Mesh(MeshBuilder().setVertices(vertices.data(), vertices.size()).setIndices(indices.data(), indices.size()).setPositionsOnly(true).setResidency(residency).build(), std::vector<Texture>())
 {
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
-	glGenBuffers(1, &ibo);
+}
 
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+Mesh::Mesh(const std::vector<Vertex> &vertices, const std::vector<int> &indices, std::vector<Texture> textures, MeshResidency residency)
+	: Mesh(vertices.data(), vertices.size(), indices.data(), indices.size(), std::move(textures), residency)
+{
+}
 
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+Mesh::Mesh(const Vertex* vertices, unsigned int vertexCount, const int* indices, unsigned int indexCount, std::vector<Texture> textures, MeshResidency residency)
+	: Mesh(MeshBuilder().setVertices(vertices, vertexCount).setIndices(indices, indexCount).setResidency(residency).build(), std::move(textures))
+{
+}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+Mesh::Mesh(MeshGeometry &&geometry, std::vector<Texture> textures)
+{
+	this->geometry = std::make_shared<MeshGeometry>(std::move(geometry));
+	this->textures = std::move(textures);
+}
 
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+Mesh::Mesh(std::shared_ptr<MeshGeometry> geometry, std::vector<Texture> textures)
+{
+	this->geometry = std::move(geometry);
+	this->textures = std::move(textures);
+}
 
-	glBindVertexArray(0);
+unsigned int Mesh::getLodCount() const
+{
+	return geometry ? (unsigned int)geometry->lods.size() : 0;
+}
+
+unsigned int Mesh::getTriangleCount(unsigned int lod) const
+{
+	if (getLodCount() == 0)
+		return 0;
+
+	return geometry->lods[std::min(lod, getLodCount() - 1)].indexCount / 3;
+}
+
+unsigned int Texture::getId() const
+{
+	return resource ? resource->id : id;
+}
+
+GLenum Texture::getTarget() const
+{
+	return resource ? resource->target : GL_TEXTURE_2D;
+}
+
+int Texture::getLayer() const
+{
+	return resource ? resource->layer : -1;
+}
+
+//"texture_diffuse1", "texture_diffuse2", ... resolved once for every sampler draw() can bind
+static std::vector<Shader::Uniform> samplerUniforms(const std::string &type)
+{
+	std::vector<Shader::Uniform> uniforms;
+	for (unsigned int number = 1; number <= 16; number++)
+		uniforms.push_back(Shader::uniform(type + std::to_string(number)));
+	return uniforms;
+}
+
+MeshInstance::MeshInstance(const glm::mat4 &model) : model(model), normalMatrix(normalMatrixOf(model))
+{
+}
+
+glm::mat3 MeshInstance::normalMatrixOf(const glm::mat4 &model)
+{
+	glm::mat3 linear(model);
+
+	//rotation times uniform scale: orthogonal columns of equal length, the inverse transpose
+	//is the matrix itself up to a scale the fragment shader normalizes away
+	float xx = glm::dot(linear[0], linear[0]);
+	float yy = glm::dot(linear[1], linear[1]);
+	float zz = glm::dot(linear[2], linear[2]);
+	float tolerance = 1e-4f * std::max(xx, std::max(yy, zz));
+	if (std::abs(xx - yy) <= tolerance && std::abs(xx - zz) <= tolerance &&
+		std::abs(glm::dot(linear[0], linear[1])) <= tolerance &&
+		std::abs(glm::dot(linear[0], linear[2])) <= tolerance &&
+		std::abs(glm::dot(linear[1], linear[2])) <= tolerance)
+		return linear;
+
+	return glm::transpose(glm::inverse(linear));
+}
+
+// binds the textures, uniforms and vertex array draw() and drawInstanced() share
+bool Mesh::bind(Shader &shader, bool instanced, unsigned int &lod)
+{
+	static const std::vector<Shader::Uniform> diffuseUniforms = samplerUniforms("texture_diffuse");
+	static const std::vector<Shader::Uniform> specularUniforms = samplerUniforms("texture_specular");
+	static const std::vector<Shader::Uniform> normalUniforms = samplerUniforms("texture_normal");
+	static const std::vector<Shader::Uniform> heightUniforms = samplerUniforms("texture_height");
+	static const Shader::Uniform textureArrayUniform = Shader::uniform("textureArray");
+	static const Shader::Uniform textureLayerUniform = Shader::uniform("textureLayer");
+	static const Shader::Uniform positionOffsetUniform = Shader::uniform("positionOffset");
+	static const Shader::Uniform positionScaleUniform = Shader::uniform("positionScale");
+	static const Shader::Uniform instancedUniform = Shader::uniform("instanced");
+
+	if (!geometry || geometry->lods.empty())
+		return false;
+
+	lod = std::min(lod, getLodCount() - 1);
+
+	GLState &state = GLState::shared();
+
+	unsigned int diffuseNr = 1;
+	unsigned int specularNr = 1;
+	unsigned int normalNr = 1;
+	unsigned int heightNr = 1;
+
+	int layer = -1;
+
+	for (unsigned int i = 0; i < textures.size(); i++)
+	{
+		const std::string &name = textures[i].type;
+
+		//array layers are picked by index in the shader instead of by binding their own texture
+		if (textures[i].getLayer() >= 0 && name == "texture_diffuse" && layer < 0)
+		{
+			layer = textures[i].getLayer();
+			state.bindTexture(TEXTURE_ARRAY_UNIT, GL_TEXTURE_2D_ARRAY, textures[i].getId());
+			continue;
+		}
+
+		const std::vector<Shader::Uniform>* samplers = nullptr;
+		unsigned int number = 0;
+		if (name == "texture_diffuse")
+			samplers = &diffuseUniforms, number = diffuseNr++;
+		else if (name == "texture_specular")
+			samplers = &specularUniforms, number = specularNr++;
+		else if (name == "texture_normal")
+			samplers = &normalUniforms, number = normalNr++;
+		else if (name == "texture_height")
+			samplers = &heightUniforms, number = heightNr++;
+
+		if (!samplers)
+			shader.set(Shader::uniform(name), (int)i);
+		else if (number <= samplers->size())
+			shader.set((*samplers)[number - 1], (int)i);
+		state.bindTexture(i, textures[i].getTarget(), textures[i].getId());
+	}
+
+	shader.set(textureArrayUniform, (int)TEXTURE_ARRAY_UNIT);
+	shader.set(textureLayerUniform, layer);
+
+	shader.set(positionOffsetUniform, geometry->positionOffset);
+	shader.set(positionScaleUniform, geometry->positionScale);
+	shader.set(instancedUniform, instanced ? 1 : 0);
+
+	// the vertex array and textures stay bound, the next mesh using them skips the binds
+	state.bindVertexArray(geometry->vao);
+	return true;
+}
+
+// render the mesh
+void Mesh::draw(Shader &shader, unsigned int lod)
+{
+	if (!bind(shader, false, lod))
+		return;
+
+	for (const MeshSubmesh &submesh : geometry->submeshes[lod])
+		glDrawElementsBaseVertex(GL_TRIANGLES, submesh.indexCount, geometry->indexType, (void*)(size_t)(submesh.indexOffset * geometry->indexSize), submesh.baseVertex);
+}
+
+void Mesh::drawInstanced(Shader &shader, unsigned int lod, GLuint instanceBuffer, size_t instanceOffset, unsigned int instanceCount)
+{
+	if (instanceCount == 0 || !bind(shader, true, lod))
+		return;
+
+	// one MeshInstance per copy, a mat4 attribute takes four vec4 locations and a mat3 three vec3 ones
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		GLuint location = INSTANCE_MATRIX_LOCATION + column;
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(MeshInstance), (void*)(instanceOffset + offsetof(MeshInstance, model) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(location, 1);
+	}
+	for (unsigned int column = 0; column < 3; column++)
+	{
+		GLuint location = INSTANCE_NORMAL_LOCATION + column;
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(MeshInstance), (void*)(instanceOffset + offsetof(MeshInstance, normalMatrix) + column * sizeof(glm::vec3)));
+		glVertexAttribDivisor(location, 1);
+	}
+
+	for (const MeshSubmesh &submesh : geometry->submeshes[lod])
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, submesh.indexCount, geometry->indexType, (void*)(size_t)(submesh.indexOffset * geometry->indexSize), instanceCount, submesh.baseVertex);
+
+	// plain draws of this vertex array must not fetch from the instance buffer
+	for (unsigned int column = 0; column < 4; column++)
+		glDisableVertexAttribArray(INSTANCE_MATRIX_LOCATION + column);
+	for (unsigned int column = 0; column < 3; column++)
+		glDisableVertexAttribArray(INSTANCE_NORMAL_LOCATION + column);
 }
 
 void Mesh::setTextures(std::vector<Texture> textures)
 {
-	this->textures = textures;
-	setup();
+	this->textures = std::move(textures);
 }
 
 Mesh::~Mesh() {}
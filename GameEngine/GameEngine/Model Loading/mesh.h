@@ -5,7 +5,10 @@
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <memory>
 #include "..\Shaders\shader.h"
+#include "texture.h"
+#include "meshLod.h"
 
 struct Vertex 
 {
@@ -58,29 +61,196 @@ struct Vertex
 	}
 };
 
+//16 byte vertex of VertexFormat::Packed, half the size of Vertex
+struct PackedVertex
+{
+	unsigned short pos[4];			//unsigned normalized over the mesh bounds, w unused
+	unsigned int normals;			//signed normalized 10_10_10_2
+	unsigned int textureCoords;		//two half floats
+};
+
+//Layout of the vertex buffer
+enum class VertexFormat
+{
+	Float,		//Vertex, 32 bytes
+	Packed		//PackedVertex, 16 bytes; the vertex shader rebuilds positions with positionOffset/positionScale
+};
+
 struct Texture 
 {
 	unsigned int id;
 	std::string type;
+	//keeps the GL texture alive while any mesh uses it (empty for textures not owned by the registry)
+	std::shared_ptr<TextureResource> resource;
+
+	//the resource decides once it exists, it may have been packed into an array since id was copied
+	unsigned int getId() const;
+	GLenum getTarget() const;
+	//slice of a GL_TEXTURE_2D_ARRAY, -1 for a plain 2D texture
+	int getLayer() const;
 };
 
+//One draw call of a level. Levels are split into several when their vertices do not fit
+//in the 65536 a 16-bit index can reach from one base vertex.
+struct MeshSubmesh
+{
+	unsigned int indexOffset;
+	unsigned int indexCount;
+	int baseVertex;
+};
+
+//Per-copy data of an instanced draw, laid out as the shader's instance attributes read it.
+//The normal matrix is the inverse transpose of the model's upper 3x3, or the 3x3 itself when
+//the model only rotates and scales uniformly (normals are renormalized per fragment).
+struct MeshInstance
+{
+	glm::mat4 model;
+	glm::mat3 normalMatrix;
+
+	MeshInstance(const glm::mat4 &model);
+
+	static glm::mat3 normalMatrixOf(const glm::mat4 &model);
+};
+
+//What a mesh keeps in RAM once its buffers are on the GPU
+enum class MeshResidency
+{
+	GpuOnly,		//GL handles, index count and bounds only
+	KeepCpuData		//also the vertices and indices, e.g. for collision or picking
+};
+
+//GPU buffers of one model, created by MeshBuilder. It owns its GL objects and is move-only,
+//so they are deleted exactly once. Meshes share it through a shared_ptr, so the same geometry
+//can be drawn with different textures from a single upload; the GL objects go away with the last owner.
+struct MeshGeometry
+{
+	unsigned int vao, vbo, ibo;
+	unsigned int indexCount;
+	size_t residentBytes;
+
+	//ranges of the buffers holding each level of detail, at least LOD 0 once built
+	std::vector<MeshLod> lods;
+
+	//GL_UNSIGNED_SHORT unless a single triangle spans more than 65536 vertices, then GL_UNSIGNED_INT
+	unsigned int indexType;
+	unsigned int indexSize;
+	//draw calls of each level, same order as lods
+	std::vector<std::vector<MeshSubmesh>> submeshes;
+
+	//object space bounding box, and the sphere around the box centre that holds every vertex
+	glm::vec3 boundsMin, boundsMax;
+	glm::vec3 boundsCenter;
+	float boundsRadius;
+
+	//position = positionOffset + attribute * positionScale; identity for the float layout
+	VertexFormat format;
+	glm::vec3 positionOffset, positionScale;
+
+	//CPU copies, only filled for MeshResidency::KeepCpuData
+	bool keepCpuData;
+	std::vector<Vertex> vertices;
+	std::vector<int> indices;
+
+	MeshGeometry();
+	MeshGeometry(MeshGeometry &&other);
+	MeshGeometry& operator=(MeshGeometry &&other);
+	~MeshGeometry();
+
+	MeshGeometry(const MeshGeometry&) = delete;
+	MeshGeometry& operator=(const MeshGeometry&) = delete;
+
+	//deletes the GL objects and forgets the data
+	void release();
+	bool isUploaded() const;
+	size_t getCpuBytes() const;
+};
+
+//Collects the data of one mesh and uploads it in a single pass: the VAO and each buffer
+//are created and filled exactly once. Nothing is copied until build(), so the source
+//memory (vectors, a mapped cache file) only has to stay alive until then.
+class MeshBuilder
+{
+	public:
+		MeshBuilder();
+
+		MeshBuilder& setVertices(const Vertex* vertices, unsigned int count);
+		MeshBuilder& setIndices(const int* indices, unsigned int count);
+		//only binds attribute 0, for meshes without normals or texture coordinates
+		MeshBuilder& setPositionsOnly(bool positionsOnly);
+		MeshBuilder& setResidency(MeshResidency residency);
+		//Packed falls back to Float for meshes canPack() rejects
+		MeshBuilder& setVertexFormat(VertexFormat format);
+		//level ranges inside the vertex and index data; without them the whole mesh is LOD 0
+		MeshBuilder& setLods(const MeshLod* lods, unsigned int count);
+
+		//must run on the GL thread
+		MeshGeometry build() const;
+
+		//half float UVs lose more than a texel on a 1024 texture outside [-2, 2], such meshes stay in floats
+		static bool canPack(const Vertex* vertices, unsigned int count);
+		static PackedVertex pack(const Vertex &vertex, glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+	private:
+		const Vertex* vertices;
+		unsigned int vertexCount;
+		const int* indices;
+		unsigned int indexCount;
+		bool positionsOnly;
+		MeshResidency residency;
+		VertexFormat format;
+		const MeshLod* lods;
+		unsigned int lodCount;
+};
+
+//A drawable: shared geometry plus its own textures. Sharing is intended, Mesh is a handle:
+//copies point at the same MeshGeometry through the shared_ptr (one upload drawn with different
+//textures, the registry handing one load to several requests), and the GL objects go away with
+//the last Mesh or registry entry holding them. Assigning Mesh() drops this handle's share only,
+//which is how LevelStreamer evicts a level's meshes.
 class Mesh
 {
 	public:
-		std::vector<Vertex> vertices;
-		std::vector<int> indices;
+		//diffuse textures packed into an array are bound here and sampled through "textureArray",
+		//away from the 2D samplers so the two sampler types never share a unit
+		static const unsigned int TEXTURE_ARRAY_UNIT = 8;
+		//first of the four attribute locations the per-instance model matrix uses, and of the three its normal matrix uses
+		static const unsigned int INSTANCE_MATRIX_LOCATION = 3;
+		static const unsigned int INSTANCE_NORMAL_LOCATION = 7;
+
 		std::vector<Texture> textures;
 
-		unsigned int vao, vbo, ibo;
+		//vertex and index data live here; only on the GPU unless the mesh was created with MeshResidency::KeepCpuData
+		std::shared_ptr<MeshGeometry> geometry;
 
 		Mesh();	
-		Mesh(std::vector<Vertex> vertices, std::vector<int> indices, std::vector<Texture> textures);
-		Mesh(std::vector<Vertex> vertices, std::vector<int> indices);
+		Mesh(const std::vector<Vertex> &vertices, const std::vector<int> &indices, std::vector<Texture> textures, MeshResidency residency = MeshResidency::GpuOnly);
+		Mesh(const std::vector<Vertex> &vertices, const std::vector<int> &indices, MeshResidency residency = MeshResidency::GpuOnly);
+		//uploads straight from the given memory (e.g. a mapped cache file)
+		Mesh(const Vertex* vertices, unsigned int vertexCount, const int* indices, unsigned int indexCount, std::vector<Texture> textures, MeshResidency residency = MeshResidency::GpuOnly);
+		//takes over geometry built by MeshBuilder
+		Mesh(MeshGeometry &&geometry, std::vector<Texture> textures);
+		//shares already uploaded (or still loading) geometry
+		Mesh(std::shared_ptr<MeshGeometry> geometry, std::vector<Texture> textures);
 		~Mesh();
 
+		//copies share the geometry, moves hand it over
+		Mesh(const Mesh&) = default;
+		Mesh(Mesh&&) = default;
+		Mesh& operator=(const Mesh&) = default;
+		Mesh& operator=(Mesh&&) = default;
+
+		//textures only affect draw(), the buffers are left alone
 		void setTextures(std::vector<Texture> textures);
-		void setup();
-		void setup2();
-		void draw(Shader shader);
+
+		unsigned int getLodCount() const;
+		unsigned int getTriangleCount(unsigned int lod = 0) const;
+		//lod is clamped to the levels the mesh has
+		void draw(Shader &shader, unsigned int lod = 0);
+		//draws instanceCount copies, each described by the MeshInstance at instanceOffset + i * sizeof(MeshInstance)
+		//in instanceBuffer; the shader reads them from instance attributes instead of the model and normalMatrix uniforms
+		void drawInstanced(Shader &shader, unsigned int lod, GLuint instanceBuffer, size_t instanceOffset, unsigned int instanceCount);
+
+	private:
+		bool bind(Shader &shader, bool instanced, unsigned int &lod);
 };
 
@@ -0,0 +1,153 @@
+#include "meshCache.h"
+#include <atomic>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+static const char MESH_CACHE_MAGIC[4] = { 'M', 'A', 'W', 'M' };
+static const uint64_t MESH_CACHE_ALIGNMENT = 64;
+
+static uint64_t alignUp(uint64_t value)
+{
+	return (value + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+}
+
+std::string MeshCache::pathFor(const std::string &objPath)
+{
+	size_t dot = objPath.find_last_of('.');
+	size_t slash = objPath.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return objPath + ".mawmesh";
+
+	return objPath.substr(0, dot) + ".mawmesh";
+}
+
+bool MeshCache::write(const std::string &path, uint64_t sourceHash, const std::vector<Vertex> &vertices, const std::vector<int> &indices, const std::vector<MeshLod> &lods)
+{
+	MeshCacheHeader h;
+	memcpy(h.magic, MESH_CACHE_MAGIC, 4);
+	h.version = VERSION;
+	h.sourceHash = sourceHash;
+	h.vertexCount = (uint32_t)vertices.size();
+	h.vertexStride = sizeof(Vertex);
+	h.indexCount = (uint32_t)indices.size();
+	h.indexStride = sizeof(int);
+	h.vertexOffset = alignUp(sizeof(MeshCacheHeader));
+	h.indexOffset = alignUp(h.vertexOffset + (uint64_t)h.vertexCount * h.vertexStride);
+	h.lodCount = (uint32_t)lods.size();
+	h.lodStride = sizeof(MeshLod);
+	h.lodOffset = alignUp(h.indexOffset + (uint64_t)h.indexCount * h.indexStride);
+
+	//write to a unique temporary name first so a crash or a second loader
+	//cooking the same file never leaves a half written cache behind
+	static std::atomic<unsigned int> tempCounter(0);
+	std::string tempPath = path + ".tmp" + std::to_string(tempCounter++);
+	std::ofstream out(tempPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.good())
+		return false;
+
+	static const char padding[MESH_CACHE_ALIGNMENT] = {};
+
+	out.write((const char*)&h, sizeof(h));
+	out.write(padding, h.vertexOffset - sizeof(h));
+	out.write((const char*)vertices.data(), (std::streamsize)h.vertexCount * h.vertexStride);
+	out.write(padding, h.indexOffset - (h.vertexOffset + (uint64_t)h.vertexCount * h.vertexStride));
+	out.write((const char*)indices.data(), (std::streamsize)h.indexCount * h.indexStride);
+	out.write(padding, h.lodOffset - (h.indexOffset + (uint64_t)h.indexCount * h.indexStride));
+	out.write((const char*)lods.data(), (std::streamsize)h.lodCount * h.lodStride);
+	out.close();
+
+	if (!out.good())
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	std::remove(path.c_str());
+	if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	//a packed copy of this cache is out of date now
+	Vfs::preferLoose(path);
+	return true;
+}
+
+bool MeshCache::open(const std::string &path, uint64_t sourceHash)
+{
+	header = nullptr;
+	if (!file.open(path))
+		return false;
+
+	//a rejected cache is unmapped right away: the caller rewrites the same file next,
+	//and Windows refuses to replace a file that is still mapped
+	if (!validate(sourceHash))
+	{
+		file.close();
+		return false;
+	}
+
+	header = (const MeshCacheHeader*)file.data();
+	return true;
+}
+
+bool MeshCache::validate(uint64_t sourceHash) const
+{
+	if (file.size() < sizeof(MeshCacheHeader))
+		return false;
+
+	const MeshCacheHeader* h = (const MeshCacheHeader*)file.data();
+	if (memcmp(h->magic, MESH_CACHE_MAGIC, 4) != 0 || h->version != VERSION || h->sourceHash != sourceHash)
+		return false;
+
+	if (h->vertexStride != sizeof(Vertex) || h->indexStride != sizeof(int) || h->lodStride != sizeof(MeshLod))
+		return false;
+
+	if (h->vertexOffset + (uint64_t)h->vertexCount * h->vertexStride > file.size() ||
+		h->indexOffset + (uint64_t)h->indexCount * h->indexStride > file.size() ||
+		h->lodOffset + (uint64_t)h->lodCount * h->lodStride > file.size())
+		return false;
+
+	//every level has to stay inside the buffers
+	const MeshLod* lods = (const MeshLod*)(file.data() + h->lodOffset);
+	for (uint32_t i = 0; i < h->lodCount; i++)
+	{
+		if ((uint64_t)lods[i].indexOffset + lods[i].indexCount > h->indexCount ||
+			(uint64_t)lods[i].vertexOffset + lods[i].vertexCount > h->vertexCount)
+			return false;
+	}
+
+	return true;
+}
+
+const Vertex* MeshCache::getVertices() const
+{
+	return (const Vertex*)(file.data() + header->vertexOffset);
+}
+
+const int* MeshCache::getIndices() const
+{
+	return (const int*)(file.data() + header->indexOffset);
+}
+
+unsigned int MeshCache::getVertexCount() const
+{
+	return header->vertexCount;
+}
+
+unsigned int MeshCache::getIndexCount() const
+{
+	return header->indexCount;
+}
+
+const MeshLod* MeshCache::getLods() const
+{
+	return (const MeshLod*)(file.data() + header->lodOffset);
+}
+
+unsigned int MeshCache::getLodCount() const
+{
+	return header->lodCount;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mesh.h"
+#include "..\Assets\vfs.h"
+
+//Cooked mesh file (.mawmesh) written next to each OBJ.
+//Layout: MeshCacheHeader, then the vertex blob, the index blob and the LOD table, each starting
+//on a 64 byte boundary, so the mapped bytes can be handed to glBufferData as they are.
+struct MeshCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceHash;
+	uint32_t vertexCount;
+	uint32_t vertexStride;
+	uint32_t indexCount;
+	uint32_t indexStride;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint32_t lodCount;
+	uint32_t lodStride;
+	uint64_t lodOffset;
+};
+
+class MeshCache
+{
+	public:
+		//bump when the cooked output changes (parser, vertex layout, ...)
+		static const uint32_t VERSION = 3;
+
+		static std::string pathFor(const std::string &objPath);
+		static bool write(const std::string &path, uint64_t sourceHash, const std::vector<Vertex> &vertices, const std::vector<int> &indices, const std::vector<MeshLod> &lods);
+
+		//maps the cache, false if it is missing, corrupt or cooked from different source bytes
+		bool open(const std::string &path, uint64_t sourceHash);
+
+		const Vertex* getVertices() const;
+		const int* getIndices() const;
+		unsigned int getVertexCount() const;
+		unsigned int getIndexCount() const;
+		const MeshLod* getLods() const;
+		unsigned int getLodCount() const;
+
+	private:
+		//checks the mapped header and ranges against the source
+		bool validate(uint64_t sourceHash) const;
+
+		VfsFile file;
+		const MeshCacheHeader* header = nullptr;
+};
@@ -1,20 +1,26 @@
 #include "meshLoaderObj.h"
 #include "stringTokenizer.h"
+#include "objParser.h"
+#include "mappedFile.h"
+#include "..\Assets\vfs.h"
+#include "meshCache.h"
+#include "contentHash.h"
+#include "meshOptimizer.h"
+#include "meshSimplifier.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
 
 MeshLoaderObj::MeshLoaderObj() {};
 
-Mesh MeshLoaderObj::loadObj(const std::string &filename)
+//Original stringstream based reader, kept as the reference for MeshLoaderObj::benchmark
+static bool loadObjTokenized(const std::string &filename, std::vector<Vertex> &vertices, std::vector<int> &indices)
 {
-	std::vector<Vertex> vertices;
-	std::vector<int> indices;
-
 	//Reading Obj file
 	std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
 	if (!file.good())
-	{
-		std::cout << "Obj model not found " << filename << std::endl;
-		std::terminate();
-	}
+		return false;
 
 	std::string line;
 	std::vector<std::string> tokens, facetokens;
@@ -148,19 +154,302 @@ Mesh MeshLoaderObj::loadObj(const std::string &filename)
 		}
 	}
 
-	std::cout << "Loading:  " << filename << std::endl;
+	return true;
+}
 
-	Mesh mesh(vertices, indices);
+Mesh MeshLoaderObj::loadObj(const std::string &filename)
+{
+	return loadObj(filename, std::vector<Texture>());
+}
 
-	return mesh;
+Mesh MeshLoaderObj::loadObj(const std::string &filename, std::vector<Texture> textures, MeshResidency residency)
+{
+	MeshData data;
+	if (!readObj(filename, data))
+	{
+		std::cout << "Obj model not found " << filename << std::endl;
+		std::terminate();
+	}
+
+	std::cout << "Loading:  " << filename << (data.cached ? " (cached)" : "") << std::endl;
+
+	return Mesh(MeshBuilder()
+		.setVertices(data.getVertices(), data.getVertexCount())
+		.setIndices(data.getIndices(), data.getIndexCount())
+		.setLods(data.getLods(), data.getLodCount())
+		.setResidency(residency)
+		.build(), std::move(textures));
+}
+
+bool MeshLoaderObj::readObj(const std::string &filename, MeshData &data)
+{
+	//Reading Obj file, from the asset pack when one is mounted
+	VfsFile file(filename);
+	if (!file.isOpen())
+		return false;
+
+	//A cooked .mawmesh next to the OBJ is used as long as it was built from the same bytes
+	uint64_t sourceHash = hashContent(file.data(), file.size());
+	std::string cachePath = MeshCache::pathFor(filename);
+
+	data.cached = data.cache.open(cachePath, sourceHash);
+	if (data.cached)
+		return true;
+
+	ObjParser parser;
+	parser.parse(file.data(), file.end(), data.vertices, data.indices);
+	MeshOptimizer::optimize(data.vertices, data.indices);
+	MeshSimplifier::buildLods(data.vertices, data.indices, data.lods);
+
+	if (!MeshCache::write(cachePath, sourceHash, data.vertices, data.indices, data.lods))
+		printf("Could not write mesh cache %s\n", cachePath.c_str());
+
+	return true;
 }
 
-Mesh MeshLoaderObj::loadObj(const std::string &filename, std::vector<Texture> textures)
+void MeshLoaderObj::cookDirectory(const std::string &directory)
 {
-	Mesh mesh = loadObj(filename);
-	mesh.setTextures(textures);
+	for (const auto &entry : std::filesystem::directory_iterator(directory))
+	{
+		if (entry.path().extension() != ".obj")
+			continue;
 
-	return mesh;
+		MeshData data;
+		if (readObj(entry.path().generic_string(), data))
+			std::cout << (data.cached ? "Up to date: " : "Cooked:     ") << entry.path().generic_string() << std::endl;
+	}
 }
 
+const Vertex* MeshData::getVertices() const
+{
+	return cached ? cache.getVertices() : vertices.data();
+}
+
+const int* MeshData::getIndices() const
+{
+	return cached ? cache.getIndices() : indices.data();
+}
+
+unsigned int MeshData::getVertexCount() const
+{
+	return cached ? cache.getVertexCount() : (unsigned int)vertices.size();
+}
+
+unsigned int MeshData::getIndexCount() const
+{
+	return cached ? cache.getIndexCount() : (unsigned int)indices.size();
+}
+
+const MeshLod* MeshData::getLods() const
+{
+	return cached ? cache.getLods() : lods.data();
+}
+
+unsigned int MeshData::getLodCount() const
+{
+	return cached ? cache.getLodCount() : (unsigned int)lods.size();
+}
+
+void MeshLoaderObj::benchmark(const std::string &directory, int runs)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	std::cout << "OBJ parse benchmark, best of " << runs << " runs per file" << std::endl;
+	std::cout << std::left << std::setw(24) << "model" << std::right << std::setw(10) << "KB"
+		<< std::setw(16) << "tokenizer MB/s" << std::setw(16) << "streaming MB/s" << std::setw(10) << "speedup" << std::endl;
+
+	double totalMB = 0.0, totalTokenized = 0.0, totalStreaming = 0.0;
+
+	for (const auto &entry : std::filesystem::directory_iterator(directory))
+	{
+		if (entry.path().extension() != ".obj")
+			continue;
+
+		std::string filename = entry.path().string();
+		double mb = (double)entry.file_size() / (1024.0 * 1024.0);
+
+		std::vector<Vertex> vertices;
+		std::vector<int> indices;
+		double bestTokenized = 1e30, bestStreaming = 1e30;
+
+		for (int run = 0; run < runs; run++)
+		{
+			vertices.clear();
+			indices.clear();
+			Clock::time_point start = Clock::now();
+			loadObjTokenized(filename, vertices, indices);
+			bestTokenized = std::min(bestTokenized, std::chrono::duration<double>(Clock::now() - start).count());
+
+			size_t referenceIndices = indices.size();
+
+			vertices.clear();
+			indices.clear();
+			start = Clock::now();
+			MappedFile file(filename);
+			ObjParser parser;
+			parser.parse(file.data(), file.end(), vertices, indices);
+			bestStreaming = std::min(bestStreaming, std::chrono::duration<double>(Clock::now() - start).count());
+
+			if (indices.size() != referenceIndices)
+				std::cout << "Mismatch between parsers on " << filename << std::endl;
+		}
 
+		totalMB += mb;
+		totalTokenized += bestTokenized;
+		totalStreaming += bestStreaming;
+
+		std::cout << std::left << std::setw(24) << entry.path().filename().string() << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(10) << mb * 1024.0 << std::setw(16) << mb / bestTokenized << std::setw(16) << mb / bestStreaming
+			<< std::setw(9) << bestTokenized / bestStreaming << "x" << std::endl;
+	}
+
+	if (totalTokenized > 0.0)
+	{
+		std::cout << std::left << std::setw(24) << "total" << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(10) << totalMB * 1024.0 << std::setw(16) << totalMB / totalTokenized << std::setw(16) << totalMB / totalStreaming
+			<< std::setw(9) << totalTokenized / totalStreaming << "x" << std::endl;
+	}
+}
+
+void MeshLoaderObj::report(const std::string &directory)
+{
+	std::cout << "Mesh report for " << directory << std::endl;
+	std::cout << std::left << std::setw(24) << "model" << std::right << std::setw(12) << "corners" << std::setw(12) << "welded"
+		<< std::setw(12) << "indices" << std::setw(14) << "VBO KB before" << std::setw(14) << "VBO KB after" << std::setw(14) << "VBO KB packed"
+		<< std::setw(14) << "max pos error" << std::endl;
+
+	size_t totalCorners = 0, totalWelded = 0, totalPacked = 0;
+
+	for (const auto &entry : std::filesystem::directory_iterator(directory))
+	{
+		if (entry.path().extension() != ".obj")
+			continue;
+
+		MappedFile file(entry.path().string());
+		if (!file.isOpen())
+			continue;
+
+		std::vector<Vertex> vertices;
+		std::vector<int> indices;
+		ObjParser parser;
+		parser.parse(file.data(), file.end(), vertices, indices);
+
+		//without welding every face corner is its own vertex
+		size_t corners = parser.getCornerCount();
+		totalCorners += corners;
+		totalWelded += vertices.size();
+
+		//packed size and the worst position error after the 16-bit round trip
+		glm::vec3 boundsMin, boundsMax;
+		boundsMin = boundsMax = vertices.empty() ? glm::vec3(0.0f) : vertices[0].pos;
+		for (const Vertex &v : vertices)
+		{
+			boundsMin = glm::min(boundsMin, v.pos);
+			boundsMax = glm::max(boundsMax, v.pos);
+		}
+
+		bool packable = MeshBuilder::canPack(vertices.data(), vertices.size());
+		size_t packedBytes = vertices.size() * (packable ? sizeof(PackedVertex) : sizeof(Vertex));
+		totalPacked += packedBytes;
+
+		float maxError = 0.0f;
+		if (packable)
+		{
+			for (const Vertex &v : vertices)
+			{
+				PackedVertex p = MeshBuilder::pack(v, boundsMin, boundsMax);
+				for (int axis = 0; axis < 3; axis++)
+				{
+					float restored = boundsMin[axis] + p.pos[axis] / 65535.0f * (boundsMax[axis] - boundsMin[axis]);
+					maxError = std::max(maxError, std::abs(restored - v.pos[axis]));
+				}
+			}
+		}
+
+		std::cout << std::left << std::setw(24) << entry.path().filename().string() << std::right
+			<< std::setw(12) << corners << std::setw(12) << vertices.size() << std::setw(12) << indices.size()
+			<< std::fixed << std::setprecision(1)
+			<< std::setw(14) << corners * sizeof(Vertex) / 1024.0 << std::setw(14) << vertices.size() * sizeof(Vertex) / 1024.0
+			<< std::setw(14) << packedBytes / 1024.0 << std::setprecision(5) << std::setw(14);
+		if (packable)
+			std::cout << maxError << std::endl;
+		else
+			std::cout << "float UVs" << std::endl;
+	}
+
+	std::cout << std::left << std::setw(24) << "total" << std::right << std::setw(12) << totalCorners << std::setw(12) << totalWelded
+		<< std::setw(12) << "" << std::fixed << std::setprecision(1)
+		<< std::setw(14) << totalCorners * sizeof(Vertex) / 1024.0 << std::setw(14) << totalWelded * sizeof(Vertex) / 1024.0
+		<< std::setw(14) << totalPacked / 1024.0 << std::endl;
+
+	//what the cook time reordering buys on each model
+	std::cout << std::endl << "Vertex cache (FIFO " << MeshOptimizer::CACHE_SIZE << ")" << std::endl;
+	std::cout << std::left << std::setw(24) << "model" << std::right << std::setw(14) << "ACMR before" << std::setw(14) << "ACMR after"
+		<< std::setw(14) << "ATVR before" << std::setw(14) << "ATVR after" << std::setw(12) << "ms" << std::endl;
+
+	for (const auto &entry : std::filesystem::directory_iterator(directory))
+	{
+		if (entry.path().extension() != ".obj")
+			continue;
+
+		MappedFile file(entry.path().string());
+		if (!file.isOpen())
+			continue;
+
+		std::vector<Vertex> vertices;
+		std::vector<int> indices;
+		ObjParser parser;
+		parser.parse(file.data(), file.end(), vertices, indices);
+
+		MeshOptimizer::CacheStats before = MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+
+		auto start = std::chrono::high_resolution_clock::now();
+		MeshOptimizer::optimize(vertices, indices);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		MeshOptimizer::CacheStats after = MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+
+		std::cout << std::left << std::setw(24) << entry.path().filename().string() << std::right << std::fixed << std::setprecision(3)
+			<< std::setw(14) << before.acmr << std::setw(14) << after.acmr << std::setw(14) << before.atvr << std::setw(14) << after.atvr
+			<< std::setprecision(1) << std::setw(12) << ms << std::endl;
+	}
+
+	//triangles per level of the generated chain
+	std::cout << std::endl << "LOD chain" << std::endl;
+	std::cout << std::left << std::setw(24) << "model" << std::right;
+	for (unsigned int lod = 0; lod < MAX_MESH_LODS; lod++)
+		std::cout << std::setw(10) << "LOD " + std::to_string(lod);
+	std::cout << std::setw(14) << "extra VBO KB" << std::setw(12) << "ms" << std::endl;
+
+	for (const auto &entry : std::filesystem::directory_iterator(directory))
+	{
+		if (entry.path().extension() != ".obj")
+			continue;
+
+		MappedFile file(entry.path().string());
+		if (!file.isOpen())
+			continue;
+
+		std::vector<Vertex> vertices;
+		std::vector<int> indices;
+		std::vector<MeshLod> lods;
+		ObjParser parser;
+		parser.parse(file.data(), file.end(), vertices, indices);
+		MeshOptimizer::optimize(vertices, indices);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		MeshSimplifier::buildLods(vertices, indices, lods);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		std::cout << std::left << std::setw(24) << entry.path().filename().string() << std::right;
+		for (unsigned int lod = 0; lod < MAX_MESH_LODS; lod++)
+		{
+			if (lod < lods.size())
+				std::cout << std::setw(10) << lods[lod].indexCount / 3;
+			else
+				std::cout << std::setw(10) << "-";
+		}
+		std::cout << std::fixed << std::setprecision(1) << std::setw(14) << (vertices.size() - lods[0].vertexCount) * sizeof(Vertex) / 1024.0
+			<< std::setw(12) << ms << std::endl;
+	}
+}
@@ -7,12 +7,44 @@
 #include <gtc\matrix_transform.hpp>
 #include <gtc\type_ptr.hpp>
 #include "mesh.h"
+#include "meshCache.h"
+
+//CPU side result of reading an OBJ, ready to be uploaded on the GL thread.
+//When a valid cache was found the data stays in the mapped .mawmesh file.
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<int> indices;
+	std::vector<MeshLod> lods;
+	MeshCache cache;
+	bool cached = false;
+
+	const Vertex* getVertices() const;
+	const int* getIndices() const;
+	unsigned int getVertexCount() const;
+	unsigned int getIndexCount() const;
+	const MeshLod* getLods() const;
+	unsigned int getLodCount() const;
+};
 
 class MeshLoaderObj
 {
 	public:
 		MeshLoaderObj();
-		Mesh loadObj(const std::string &filename, std::vector<Texture> textures);
+		Mesh loadObj(const std::string &filename, std::vector<Texture> textures, MeshResidency residency = MeshResidency::GpuOnly);
 		Mesh loadObj(const std::string &filename);
+
+		//Reads (or cooks) the mesh without touching GL, safe to call from worker threads
+		static bool readObj(const std::string &filename, MeshData &data);
+
+		//Reads every .obj in a directory once, so each gets an up to date .mawmesh
+		static void cookDirectory(const std::string &directory);
+
+		//Times the streaming parser against the old tokenizer on every .obj in a directory
+		static void benchmark(const std::string &directory, int runs = 5);
+
+		//Prints vertex and index counts before and after welding, the packed vertex size
+		//with its largest position error, cache statistics and the LOD chain for every .obj in a directory
+		static void report(const std::string &directory);
 };
 
@@ -0,0 +1,57 @@
+#include "meshLod.h"
+#include <algorithm>
+
+unsigned int LodSettings::select(float screenPixels, unsigned int lodCount) const
+{
+	if (!enabled || lodCount == 0)
+		return 0;
+
+	unsigned int lod = 0;
+	while (lod + 1 < lodCount && lod < MAX_MESH_LODS - 1 && screenPixels < thresholds[lod])
+		lod++;
+
+	return lod;
+}
+
+float LodSettings::screenPixels(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &model,
+	const glm::vec3 &cameraPosition, const glm::mat4 &projection, float viewportHeight)
+{
+	glm::vec3 center = glm::vec3(model * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+
+	//the largest axis scale keeps the sphere conservative under non uniform scaling
+	float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	float radius = glm::length(boundsMax - boundsMin) * 0.5f * scale;
+
+	float distance = glm::length(center - cameraPosition);
+	if (distance <= radius)
+		return viewportHeight * 2.0f;
+
+	//projection[1][1] is cot(fov / 2), i.e. how many half viewports one unit at distance 1 covers
+	return radius / distance * projection[1][1] * viewportHeight;
+}
+
+LodStats::LodStats()
+{
+	reset();
+}
+
+void LodStats::reset()
+{
+	for (unsigned int i = 0; i < MAX_MESH_LODS; i++)
+		draws[i] = 0;
+
+	fullTriangles = 0;
+	drawnTriangles = 0;
+}
+
+void LodStats::record(unsigned int lod, unsigned int fullTriangleCount, unsigned int drawnTriangleCount)
+{
+	draws[std::min(lod, MAX_MESH_LODS - 1)]++;
+	fullTriangles += fullTriangleCount;
+	drawnTriangles += drawnTriangleCount;
+}
+
+unsigned long long LodStats::getSavedTriangles() const
+{
+	return fullTriangles - drawnTriangles;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <glm.hpp>
+
+//LOD 0 is the full mesh, every further level has roughly half the triangles of the one before
+static const unsigned int MAX_MESH_LODS = 4;
+
+//One level of detail inside a mesh's shared vertex and index buffers.
+//Indices are relative to vertexOffset, so each level is drawn with glDrawElementsBaseVertex.
+struct MeshLod
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	uint32_t vertexOffset;
+	uint32_t vertexCount;
+};
+
+//Picks a level from how large a mesh's bounding sphere is on screen
+struct LodSettings
+{
+	bool enabled = true;
+	//projected diameter in pixels below which LOD i + 1 is used
+	float thresholds[MAX_MESH_LODS - 1] = { 200.0f, 80.0f, 30.0f };
+
+	unsigned int select(float screenPixels, unsigned int lodCount) const;
+
+	//diameter in pixels of the bounding sphere of an object space box drawn with model
+	static float screenPixels(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &model,
+		const glm::vec3 &cameraPosition, const glm::mat4 &projection, float viewportHeight);
+};
+
+//Counts of one frame, to see what the LOD selection saves
+struct LodStats
+{
+	unsigned int draws[MAX_MESH_LODS];
+	unsigned long long fullTriangles;
+	unsigned long long drawnTriangles;
+
+	LodStats();
+	void reset();
+	void record(unsigned int lod, unsigned int fullTriangleCount, unsigned int drawnTriangleCount);
+	unsigned long long getSavedTriangles() const;
+};
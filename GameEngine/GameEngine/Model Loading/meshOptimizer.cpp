@@ -0,0 +1,282 @@
+#include "meshOptimizer.h"
+#include <algorithm>
+
+namespace
+{
+	//FIFO cache simulation, returns how many of the triangle's vertices were misses
+	class FifoCache
+	{
+		public:
+			FifoCache(unsigned int vertexCount, unsigned int size) : stamps(vertexCount, 0), size(size), time(size + 1) {}
+
+			unsigned int add(int a, int b, int c)
+			{
+				return add(a) + add(b) + add(c);
+			}
+
+			void clear()
+			{
+				//moving the clock past every stamp empties the cache
+				time += size + 1;
+			}
+
+		private:
+			unsigned int add(int v)
+			{
+				if (time - stamps[v] <= size)
+					return 0;
+
+				stamps[v] = time++;
+				return 1;
+			}
+
+			std::vector<unsigned int> stamps;
+			unsigned int size;
+			unsigned int time;
+	};
+
+	struct Cluster
+	{
+		unsigned int begin, end;
+		float sortKey;
+	};
+}
+
+void MeshOptimizer::optimize(std::vector<Vertex> &vertices, std::vector<int> &indices)
+{
+	optimizeVertexCache(indices, vertices.size());
+	optimizeOverdraw(indices, vertices);
+	optimizeVertexFetch(vertices, indices);
+}
+
+//Tipsify (Sander, Nehab, Barczak 2007): fan around a vertex, emit all its remaining triangles,
+//then continue with the most recently used vertex that still has triangles and will stay in cache.
+void MeshOptimizer::optimizeVertexCache(std::vector<int> &indices, unsigned int vertexCount)
+{
+	unsigned int triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	//vertex -> triangles adjacency, as offsets into one list
+	std::vector<unsigned int> live(vertexCount, 0);
+	for (unsigned int i = 0; i < triangleCount * 3; i++)
+		live[indices[i]]++;
+
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + live[v];
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (unsigned int t = 0; t < triangleCount; t++)
+		for (int k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = t;
+
+	std::vector<unsigned int> stamps(vertexCount, 0);
+	std::vector<char> emitted(triangleCount, 0);
+	std::vector<int> deadEnds;
+	std::vector<int> candidates;
+	std::vector<int> result;
+	result.reserve(triangleCount * 3);
+
+	unsigned int time = CACHE_SIZE + 1;
+	unsigned int cursor = 0;
+	int fan = indices[0];
+
+	while (fan >= 0)
+	{
+		candidates.clear();
+
+		for (unsigned int a = offsets[fan]; a < offsets[fan + 1]; a++)
+		{
+			unsigned int t = adjacency[a];
+			if (emitted[t])
+				continue;
+
+			for (int k = 0; k < 3; k++)
+			{
+				int v = indices[t * 3 + k];
+				result.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+
+				if (time - stamps[v] > CACHE_SIZE)
+					stamps[v] = time++;
+			}
+
+			emitted[t] = 1;
+		}
+
+		//best candidate: still has triangles and its whole fan fits before it leaves the cache
+		int next = -1;
+		unsigned int best = 0;
+		for (int v : candidates)
+		{
+			if (live[v] == 0)
+				continue;
+
+			unsigned int priority = 0;
+			if (time - stamps[v] + 2 * live[v] <= CACHE_SIZE)
+				priority = time - stamps[v];
+
+			if (priority > best)
+			{
+				best = priority;
+				next = v;
+			}
+		}
+
+		//dead end: back up through recently used vertices, then scan the input order
+		if (next < 0)
+		{
+			while (!deadEnds.empty() && next < 0)
+			{
+				int v = deadEnds.back();
+				deadEnds.pop_back();
+				if (live[v] > 0)
+					next = v;
+			}
+
+			while (next < 0 && cursor < vertexCount)
+			{
+				if (live[cursor] > 0)
+					next = cursor;
+				cursor++;
+			}
+		}
+
+		fan = next;
+	}
+
+	//some inputs (e.g. exported grids) already come in a better order
+	if (analyzeVertexCache(result, vertexCount).acmr < analyzeVertexCache(indices, vertexCount).acmr)
+		indices.swap(result);
+}
+
+//Cluster sorting from the same paper (as done in meshoptimizer): the cache ordered list is cut
+//into clusters, cut finer while their ACMR stays within threshold, and the clusters are drawn
+//from the ones facing most outwards to the most inwards, so outer surfaces tend to be drawn before what they hide.
+void MeshOptimizer::optimizeOverdraw(std::vector<int> &indices, const std::vector<Vertex> &vertices, float threshold)
+{
+	unsigned int triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	//hard boundaries: a triangle missing on all three vertices usually starts a new patch
+	std::vector<unsigned int> clusters;
+	FifoCache cache(vertices.size(), CACHE_SIZE);
+	for (unsigned int t = 0; t < triangleCount; t++)
+		if (cache.add(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]) == 3 || t == 0)
+			clusters.push_back(t);
+
+	//soft boundaries inside each hard cluster
+	std::vector<Cluster> split;
+
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		unsigned int begin = clusters[c];
+		unsigned int end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+		cache.clear();
+		unsigned int clusterMisses = 0;
+		for (unsigned int t = begin; t < end; t++)
+			clusterMisses += cache.add(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]);
+		float clusterThreshold = threshold * clusterMisses / (end - begin);
+
+		cache.clear();
+		unsigned int runningMisses = 0, runningBegin = begin;
+		for (unsigned int t = begin; t < end; t++)
+		{
+			runningMisses += cache.add(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]);
+
+			if (t + 1 < end && (float)runningMisses / (t + 1 - runningBegin) <= clusterThreshold)
+			{
+				split.push_back(Cluster{ runningBegin, t + 1, 0.0f });
+				runningBegin = t + 1;
+				runningMisses = 0;
+				cache.clear();
+			}
+		}
+		split.push_back(Cluster{ runningBegin, end, 0.0f });
+	}
+
+	//area weighted centroid of the whole mesh
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		const glm::vec3 &a = vertices[indices[t * 3]].pos, &b = vertices[indices[t * 3 + 1]].pos, &c = vertices[indices[t * 3 + 2]].pos;
+		float area = glm::length(glm::cross(b - a, c - a));
+		meshCentroid += (a + b + c) * (area / 3.0f);
+		meshArea += area;
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	//clusters facing away from the centre first
+	for (Cluster &cluster : split)
+	{
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (unsigned int t = cluster.begin; t < cluster.end; t++)
+		{
+			const glm::vec3 &a = vertices[indices[t * 3]].pos, &b = vertices[indices[t * 3 + 1]].pos, &c = vertices[indices[t * 3 + 2]].pos;
+			glm::vec3 n = glm::cross(b - a, c - a);
+			float triangleArea = glm::length(n);
+			centroid += (a + b + c) * (triangleArea / 3.0f);
+			normal += n;
+			area += triangleArea;
+		}
+
+		float normalLength = glm::length(normal);
+		if (area > 0.0f && normalLength > 0.0f)
+			cluster.sortKey = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+	}
+
+	std::stable_sort(split.begin(), split.end(), [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+	std::vector<int> result;
+	result.reserve(indices.size());
+	for (const Cluster &cluster : split)
+		result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+
+	indices.swap(result);
+}
+
+//vertices in first use order, so the fetches walk the vertex buffer forwards; unused vertices are dropped
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<int> &indices)
+{
+	std::vector<int> remap(vertices.size(), -1);
+	std::vector<Vertex> result;
+	result.reserve(vertices.size());
+
+	for (int &index : indices)
+	{
+		if (remap[index] < 0)
+		{
+			remap[index] = (int)result.size();
+			result.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(result);
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const std::vector<int> &indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	CacheStats stats = { 0.0f, 0.0f };
+	unsigned int triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return stats;
+
+	FifoCache cache(vertexCount, cacheSize);
+	unsigned int misses = 0;
+	for (unsigned int t = 0; t < triangleCount; t++)
+		misses += cache.add(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]);
+
+	stats.acmr = (float)misses / triangleCount;
+	stats.atvr = (float)misses / vertexCount;
+	return stats;
+}
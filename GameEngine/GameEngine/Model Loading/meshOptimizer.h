@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include "mesh.h"
+
+//Load/cook time reordering of indexed triangle lists for the GPU:
+//triangles for post-transform vertex cache hits (Tipsify), then clusters of them
+//for less overdraw, then vertices in the order the index buffer first fetches them.
+//None of it changes what is drawn, only the order.
+class MeshOptimizer
+{
+	public:
+		//FIFO size assumed for the post-transform cache, both when optimizing and when measuring
+		static const unsigned int CACHE_SIZE = 16;
+
+		struct CacheStats
+		{
+			float acmr;		//average cache misses per triangle, 0.5 is the ideal for large meshes, 3 the worst
+			float atvr;		//average transforms per vertex, 1 is the ideal
+		};
+
+		//runs all three passes
+		static void optimize(std::vector<Vertex> &vertices, std::vector<int> &indices);
+
+		static void optimizeVertexCache(std::vector<int> &indices, unsigned int vertexCount);
+		//expects cache optimized input; threshold is how much ACMR may grow to cut clusters finer
+		static void optimizeOverdraw(std::vector<int> &indices, const std::vector<Vertex> &vertices, float threshold = 1.05f);
+		static void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<int> &indices);
+
+		static CacheStats analyzeVertexCache(const std::vector<int> &indices, unsigned int vertexCount, unsigned int cacheSize = CACHE_SIZE);
+};
@@ -0,0 +1,251 @@
+#include "meshSimplifier.h"
+#include "meshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+namespace
+{
+	//Grid over the mesh bounds with cells of the same size on every axis
+	struct Grid
+	{
+		glm::vec3 origin;
+		float cellSize;
+		int dims[3];
+
+		Grid(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, int resolution)
+		{
+			glm::vec3 extent = boundsMax - boundsMin;
+			float longest = std::max(extent.x, std::max(extent.y, extent.z));
+
+			origin = boundsMin;
+			cellSize = longest > 0.0f ? longest / resolution : 1.0f;
+			for (int axis = 0; axis < 3; axis++)
+				dims[axis] = std::max(1, std::min(resolution, (int)(extent[axis] / cellSize) + 1));
+		}
+
+		int cellOf(const glm::vec3 &p) const
+		{
+			int c[3];
+			for (int axis = 0; axis < 3; axis++)
+				c[axis] = std::max(0, std::min(dims[axis] - 1, (int)((p[axis] - origin[axis]) / cellSize)));
+
+			return (c[2] * dims[1] + c[1]) * dims[0] + c[0];
+		}
+	};
+
+	//maps every vertex to a dense cluster id, returns the cluster count
+	unsigned int clusterVertices(const Vertex* vertices, unsigned int vertexCount, const Grid &grid, std::vector<int> &clusterOf)
+	{
+		std::unordered_map<int, int> clusterOfCell;
+		clusterOf.resize(vertexCount);
+
+		for (unsigned int v = 0; v < vertexCount; v++)
+		{
+			auto inserted = clusterOfCell.insert(std::make_pair(grid.cellOf(vertices[v].pos), (int)clusterOfCell.size()));
+			clusterOf[v] = inserted.first->second;
+		}
+
+		return (unsigned int)clusterOfCell.size();
+	}
+
+	//triangles whose corners land in three different clusters, without duplicates, winding kept
+	void collapseTriangles(const int* indices, unsigned int indexCount, const std::vector<int> &clusterOf, std::vector<std::array<int, 3>> &triangles)
+	{
+		triangles.clear();
+
+		for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+		{
+			int a = clusterOf[indices[i]], b = clusterOf[indices[i + 1]], c = clusterOf[indices[i + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+
+			//rotate the smallest id to the front so duplicates compare equal
+			if (b < a && b < c)
+				triangles.push_back({ b, c, a });
+			else if (c < a && c < b)
+				triangles.push_back({ c, a, b });
+			else
+				triangles.push_back({ a, b, c });
+		}
+
+		std::sort(triangles.begin(), triangles.end());
+		triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+	}
+
+	//symmetric 3x3 part, linear part and constant of a sum of squared plane distances
+	struct Quadric
+	{
+		glm::mat3 a;
+		glm::vec3 b;
+		float area;
+
+		Quadric() : a(0.0f), b(0.0f), area(0.0f) {}
+
+		void addPlane(const glm::vec3 &normal, float d, float weight)
+		{
+			a += glm::outerProduct(normal, normal) * weight;
+			b += normal * (d * weight);
+			area += weight;
+		}
+	};
+}
+
+void MeshSimplifier::simplify(const Vertex* vertices, unsigned int vertexCount, const int* indices, unsigned int indexCount,
+	unsigned int targetTriangles, std::vector<Vertex> &outVertices, std::vector<int> &outIndices)
+{
+	outVertices.clear();
+	outIndices.clear();
+	if (vertexCount == 0 || indexCount < 3)
+		return;
+
+	glm::vec3 boundsMin = vertices[0].pos, boundsMax = vertices[0].pos;
+	for (unsigned int v = 1; v < vertexCount; v++)
+	{
+		boundsMin = glm::min(boundsMin, vertices[v].pos);
+		boundsMax = glm::max(boundsMax, vertices[v].pos);
+	}
+
+	//finest grid that still meets the target; the triangle count grows with the resolution
+	std::vector<int> clusterOf;
+	std::vector<std::array<int, 3>> triangles;
+	int low = 1, high = 1024, best = 0;
+
+	while (low <= high)
+	{
+		int resolution = (low + high) / 2;
+		clusterVertices(vertices, vertexCount, Grid(boundsMin, boundsMax, resolution), clusterOf);
+		collapseTriangles(indices, indexCount, clusterOf, triangles);
+
+		if (triangles.size() <= targetTriangles)
+		{
+			best = resolution;
+			low = resolution + 1;
+		}
+		else
+		{
+			high = resolution - 1;
+		}
+	}
+
+	if (best == 0)
+		return;
+
+	Grid grid(boundsMin, boundsMax, best);
+	unsigned int clusterCount = clusterVertices(vertices, vertexCount, grid, clusterOf);
+	collapseTriangles(indices, indexCount, clusterOf, triangles);
+	if (triangles.empty())
+		return;
+
+	//surface planes of the original triangles, accumulated into the clusters they touch
+	std::vector<Quadric> quadrics(clusterCount);
+	std::vector<glm::vec3> positionSum(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> normalSum(clusterCount, glm::vec3(0.0f));
+	std::vector<unsigned int> members(clusterCount, 0);
+
+	for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+	{
+		const glm::vec3 &p0 = vertices[indices[i]].pos, &p1 = vertices[indices[i + 1]].pos, &p2 = vertices[indices[i + 2]].pos;
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(n);
+		if (length <= 0.0f)
+			continue;
+
+		n /= length;
+		float d = -glm::dot(n, p0);
+		for (int k = 0; k < 3; k++)
+			quadrics[clusterOf[indices[i + k]]].addPlane(n, d, length * 0.5f);
+	}
+
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		int c = clusterOf[v];
+		positionSum[c] += vertices[v].pos;
+		normalSum[c] += vertices[v].normals;
+		members[c]++;
+	}
+
+	//one vertex per cluster used by a kept triangle
+	std::vector<int> outputOf(clusterCount, -1);
+	for (const std::array<int, 3> &t : triangles)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			int c = t[k];
+			if (outputOf[c] >= 0)
+				continue;
+
+			glm::vec3 average = positionSum[c] / (float)members[c];
+			glm::vec3 position = average;
+
+			//minimize the quadric when it is well conditioned, staying inside the cell's neighbourhood
+			const Quadric &q = quadrics[c];
+			float scale = (q.a[0][0] + q.a[1][1] + q.a[2][2]) / 3.0f;
+			if (scale > 0.0f && glm::determinant(q.a) > 1e-3f * scale * scale * scale)
+			{
+				glm::vec3 solved = glm::inverse(q.a) * -q.b;
+				glm::vec3 slack(grid.cellSize);
+				position = glm::clamp(solved, glm::max(boundsMin, average - slack), glm::min(boundsMax, average + slack));
+			}
+
+			Vertex vertex;
+			vertex.pos = position;
+			float normalLength = glm::length(normalSum[c]);
+			vertex.normals = normalLength > 0.0f ? normalSum[c] / normalLength : glm::vec3(0.0f);
+
+			outputOf[c] = (int)outVertices.size();
+			outVertices.push_back(vertex);
+		}
+
+		outIndices.push_back(outputOf[t[0]]);
+		outIndices.push_back(outputOf[t[1]]);
+		outIndices.push_back(outputOf[t[2]]);
+	}
+
+	//texture coordinates from the member closest to the new position
+	std::vector<float> closestDistance(outVertices.size(), -1.0f);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		int o = outputOf[clusterOf[v]];
+		if (o < 0)
+			continue;
+
+		float distance = glm::length(vertices[v].pos - outVertices[o].pos);
+		if (closestDistance[o] < 0.0f || distance < closestDistance[o])
+		{
+			closestDistance[o] = distance;
+			outVertices[o].textureCoords = vertices[v].textureCoords;
+		}
+	}
+}
+
+void MeshSimplifier::buildLods(std::vector<Vertex> &vertices, std::vector<int> &indices, std::vector<MeshLod> &lods)
+{
+	lods.clear();
+	lods.push_back(MeshLod{ 0, (uint32_t)indices.size(), 0, (uint32_t)vertices.size() });
+
+	unsigned int baseVertexCount = vertices.size();
+	unsigned int baseIndexCount = indices.size();
+	unsigned int triangles = baseIndexCount / 3;
+
+	std::vector<Vertex> lodVertices;
+	std::vector<int> lodIndices;
+
+	while (lods.size() < MAX_MESH_LODS && triangles >= MIN_TRIANGLES)
+	{
+		simplify(vertices.data(), baseVertexCount, indices.data(), baseIndexCount, triangles / 2, lodVertices, lodIndices);
+
+		//stop once the grid cannot take the mesh any further
+		unsigned int lodTriangles = lodIndices.size() / 3;
+		if (lodTriangles == 0 || lodTriangles >= triangles)
+			break;
+
+		MeshOptimizer::optimize(lodVertices, lodIndices);
+
+		lods.push_back(MeshLod{ (uint32_t)indices.size(), (uint32_t)lodIndices.size(), (uint32_t)vertices.size(), (uint32_t)lodVertices.size() });
+		vertices.insert(vertices.end(), lodVertices.begin(), lodVertices.end());
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+
+		triangles = lodTriangles;
+	}
+}
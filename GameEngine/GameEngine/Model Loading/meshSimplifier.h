@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include "mesh.h"
+
+//Builds lower levels of detail by vertex clustering (Rossignac-Borrel, with Lindstrom's
+//quadric placement): vertices are snapped to a grid, each occupied cell becomes one vertex
+//at the point that best fits the surface that passed through it, and triangles that
+//collapse are dropped. The grid is refined until the level has about the requested triangle count.
+class MeshSimplifier
+{
+	public:
+		//meshes below this many triangles get no extra levels
+		static const unsigned int MIN_TRIANGLES = 256;
+
+		//simplified copy of a mesh with at most targetTriangles triangles (fewer when the grid cannot hit it exactly)
+		static void simplify(const Vertex* vertices, unsigned int vertexCount, const int* indices, unsigned int indexCount,
+			unsigned int targetTriangles, std::vector<Vertex> &outVertices, std::vector<int> &outIndices);
+
+		//Appends the levels after LOD 0 to vertices and indices and describes all of them in lods.
+		//Every level is cache optimized on its own and indexed relative to its vertexOffset.
+		static void buildLods(std::vector<Vertex> &vertices, std::vector<int> &indices, std::vector<MeshLod> &lods);
+};
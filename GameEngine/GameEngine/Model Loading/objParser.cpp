@@ -0,0 +1,307 @@
+#include "objParser.h"
+#include <charconv>
+#include <cstring>
+
+namespace
+{
+	inline bool isBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	inline bool isFaceSeparator(char c)
+	{
+		return c == '/' || c == '\\';
+	}
+
+	inline const char* skipBlanks(const char* p, const char* end)
+	{
+		while (p < end && isBlank(*p)) p++;
+		return p;
+	}
+
+	inline const char* tokenEnd(const char* p, const char* end)
+	{
+		while (p < end && !isBlank(*p)) p++;
+		return p;
+	}
+
+	//Same result as streaming the token into a float: leading '+' is accepted and garbage reads as 0
+	inline float toFloat(const char* p, const char* end)
+	{
+		if (p < end && *p == '+') p++;
+		float value = 0.0f;
+		if (std::from_chars(p, end, value).ec != std::errc())
+			value = 0.0f;
+		return value;
+	}
+
+	inline int toInt(const char* p, const char* end)
+	{
+		if (p < end && *p == '+') p++;
+		int value = 0;
+		if (std::from_chars(p, end, value).ec != std::errc())
+			value = 0;
+		return value;
+	}
+
+	//Reads the next whitespace separated token as a float, false if the line has no more tokens
+	inline bool nextFloat(const char* &p, const char* lineEnd, float &value)
+	{
+		p = skipBlanks(p, lineEnd);
+		if (p == lineEnd)
+			return false;
+
+		const char* te = tokenEnd(p, lineEnd);
+		value = toFloat(p, te);
+		p = te;
+		return true;
+	}
+
+	//Splits a face corner such as "12/7/3", "12//3" or "12/7" into its numbers
+	inline int readCorner(const char* p, const char* end, int fields[3])
+	{
+		int count = 0;
+		while (p < end)
+		{
+			while (p < end && isFaceSeparator(*p)) p++;
+			if (p == end)
+				break;
+
+			const char* fieldStart = p;
+			while (p < end && !isFaceSeparator(*p)) p++;
+
+			if (count < 3)
+				fields[count] = toInt(fieldStart, p);
+			count++;
+		}
+
+		for (int i = count; i < 3; i++)
+			fields[i] = 0;
+
+		return count;
+	}
+
+	//OBJ indices are 1-based, negative values count back from the end of the list.
+	//Returns -1 for indices that do not point into the list.
+	inline int resolve(int index, size_t size)
+	{
+		if (index > 0) index -= 1;
+		else index = (int)size + index;
+
+		if (index < 0 || index >= (int)size)
+			return -1;
+
+		return index;
+	}
+
+	template <typename T>
+	inline T fetch(const std::vector<T> &list, int index)
+	{
+		return index >= 0 ? list[index] : T();
+	}
+
+	inline size_t hashCorner(int p, int t, int n)
+	{
+		size_t h = (size_t)(unsigned int)p * 73856093u ^ (size_t)(unsigned int)t * 19349663u ^ (size_t)(unsigned int)n * 83492791u;
+		return h ^ (h >> 15);
+	}
+}
+
+void ObjParser::parse(const char* begin, const char* end, std::vector<Vertex> &vertices, std::vector<int> &indices)
+{
+	positions.clear();
+	normals.clear();
+	texcoords.clear();
+	vertices.clear();
+	indices.clear();
+
+	cornerCount = 0;
+	cornerTable.assign(1024, CornerSlot{ 0, 0, 0, -1 });
+
+	const char* p = begin;
+	while (p < end)
+	{
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (lineEnd == nullptr)
+			lineEnd = end;
+
+		const char* keyword = skipBlanks(p, lineEnd);
+		const char* keywordEnd = tokenEnd(keyword, lineEnd);
+		size_t keywordLength = keywordEnd - keyword;
+
+		if (keywordLength == 1 && keyword[0] == 'v')
+		{
+			//Vertices
+			glm::vec3 v;
+			const char* c = keywordEnd;
+			if (nextFloat(c, lineEnd, v.x) && nextFloat(c, lineEnd, v.y) && nextFloat(c, lineEnd, v.z))
+				positions.push_back(v);
+		}
+		else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 'n')
+		{
+			//Normals
+			glm::vec3 n;
+			const char* c = keywordEnd;
+			if (nextFloat(c, lineEnd, n.x) && nextFloat(c, lineEnd, n.y) && nextFloat(c, lineEnd, n.z))
+				normals.push_back(n);
+		}
+		else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 't')
+		{
+			//Texture Coords
+			glm::vec2 t;
+			const char* c = keywordEnd;
+			if (nextFloat(c, lineEnd, t.x) && nextFloat(c, lineEnd, t.y))
+				texcoords.push_back(t);
+		}
+		else if (keywordLength == 1 && keyword[0] == 'f')
+		{
+			//Faces
+			parseFace(keywordEnd, lineEnd, vertices, indices);
+		}
+
+		//comments, groups, materials and smoothing groups are ignored
+		p = (lineEnd < end) ? lineEnd + 1 : end;
+	}
+}
+
+void ObjParser::parseFace(const char* p, const char* lineEnd, std::vector<Vertex> &vertices, std::vector<int> &indices)
+{
+	//a face needs at least three corners
+	int tokenCount = 0;
+	for (const char* c = skipBlanks(p, lineEnd); c < lineEnd; c = skipBlanks(tokenEnd(c, lineEnd), lineEnd))
+		tokenCount++;
+	if (tokenCount < 3)
+		return;
+
+	//The layout of the first corner decides how the whole face is read:
+	//1 = pos, 2 = pos/tex, 3 = pos//normal, 4 = pos/tex/normal
+	const char* first = skipBlanks(p, lineEnd);
+	const char* firstEnd = tokenEnd(first, lineEnd);
+
+	bool doubleSlash = false;
+	for (const char* c = first; c + 1 < firstEnd; c++)
+	{
+		if (c[0] == '/' && c[1] == '/')
+		{
+			doubleSlash = true;
+			break;
+		}
+	}
+
+	int fields[3];
+	int fieldCount = readCorner(first, firstEnd, fields);
+
+	unsigned int face_format;
+	if (fieldCount == 3)
+		face_format = 4;
+	else if (fieldCount == 2)
+		face_format = doubleSlash ? 3 : 2;
+	else
+		face_format = 1;
+
+	int first_vertex_of_face = -1;
+	int previous_vertex = -1;
+	unsigned int num_token = 1;
+
+	for (const char* c = first; c < lineEnd; num_token++)
+	{
+		const char* te = tokenEnd(c, lineEnd);
+		if (*c == '#')
+			break;
+
+		readCorner(c, te, fields);
+		cornerCount++;
+
+		//corners repeating an earlier (pos, tex, normal) triple reuse its vertex
+		int p_index = resolve(fields[0], positions.size());
+		int t_index = -1, n_index = -1;
+		if (face_format == 2) //Pos and texcoords
+			t_index = resolve(fields[1], texcoords.size());
+		else if (face_format == 3) //Pos and normal
+			n_index = resolve(fields[1], normals.size());
+		else if (face_format == 4) //Pos, texcoord and normal
+		{
+			t_index = resolve(fields[1], texcoords.size());
+			n_index = resolve(fields[2], normals.size());
+		}
+
+		int vertex = weldCorner(p_index, t_index, n_index, face_format, vertices);
+
+		//polygons are fanned around their first corner
+		if (num_token < 4)
+		{
+			if (num_token == 1)
+				first_vertex_of_face = vertex;
+
+			indices.push_back(vertex);
+		}
+		else
+		{
+			indices.push_back(first_vertex_of_face);
+			indices.push_back(previous_vertex);
+			indices.push_back(vertex);
+		}
+		previous_vertex = vertex;
+
+		c = skipBlanks(te, lineEnd);
+	}
+}
+
+int ObjParser::weldCorner(int p_index, int t_index, int n_index, unsigned int face_format, std::vector<Vertex> &vertices)
+{
+	//open addressing table, kept at most half full
+	if ((vertices.size() + 1) * 2 > cornerTable.size())
+		growCornerTable();
+
+	size_t mask = cornerTable.size() - 1;
+	size_t slot = hashCorner(p_index, t_index, n_index) & mask;
+	while (cornerTable[slot].vertex >= 0)
+	{
+		const CornerSlot &s = cornerTable[slot];
+		if (s.p == p_index && s.t == t_index && s.n == n_index)
+			return s.vertex;
+		slot = (slot + 1) & mask;
+	}
+
+	glm::vec3 pos = fetch(positions, p_index);
+	glm::vec2 tex = fetch(texcoords, t_index);
+	glm::vec3 norm = fetch(normals, n_index);
+
+	if (face_format == 1) //Just pos
+		vertices.push_back(Vertex(pos.x, pos.y, pos.z));
+	else if (face_format == 2) //Pos and texcoords
+		vertices.push_back(Vertex(pos.x, pos.y, pos.z, tex.x, tex.y));
+	else if (face_format == 3) //Pos and normal
+		vertices.push_back(Vertex(pos.x, pos.y, pos.z, norm.x, norm.y, norm.z));
+	else
+		vertices.push_back(Vertex(pos.x, pos.y, pos.z, norm.x, norm.y, norm.z, tex.x, tex.y));
+
+	int vertex = (int)vertices.size() - 1;
+	cornerTable[slot] = CornerSlot{ p_index, t_index, n_index, vertex };
+	return vertex;
+}
+
+void ObjParser::growCornerTable()
+{
+	std::vector<CornerSlot> old;
+	old.swap(cornerTable);
+	cornerTable.assign(old.size() * 2, CornerSlot{ 0, 0, 0, -1 });
+
+	size_t mask = cornerTable.size() - 1;
+	for (const CornerSlot &s : old)
+	{
+		if (s.vertex < 0)
+			continue;
+
+		size_t slot = hashCorner(s.p, s.t, s.n) & mask;
+		while (cornerTable[slot].vertex >= 0)
+			slot = (slot + 1) & mask;
+		cornerTable[slot] = s;
+	}
+}
+
+unsigned int ObjParser::getCornerCount() const
+{
+	return cornerCount;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <glm.hpp>
+#include "mesh.h"
+
+//Single pass OBJ parser that walks the raw file bytes with a cursor.
+//Numbers are converted in place with std::from_chars, so no line or token
+//strings are ever built; the only allocations are the attribute and output vectors growing.
+//Face corners are welded: every distinct (pos, tex, normal) index triple becomes one vertex.
+class ObjParser
+{
+	public:
+		void parse(const char* begin, const char* end, std::vector<Vertex> &vertices, std::vector<int> &indices);
+
+		//face corners read by the last parse, i.e. the vertex count without welding
+		unsigned int getCornerCount() const;
+
+	private:
+		struct CornerSlot
+		{
+			int p, t, n;
+			int vertex;
+		};
+
+		void parseFace(const char* p, const char* lineEnd, std::vector<Vertex> &vertices, std::vector<int> &indices);
+		int weldCorner(int p_index, int t_index, int n_index, unsigned int face_format, std::vector<Vertex> &vertices);
+		void growCornerTable();
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> texcoords;
+
+		std::vector<CornerSlot> cornerTable;
+		unsigned int cornerCount;
+};
@@ -0,0 +1,573 @@
+#include "pngDecoder.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const unsigned char PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	//largest side accepted, checked before any buffer is sized from the header
+	const unsigned int MAX_PNG_DIMENSION = 16384;
+
+	inline uint32_t readBE32(const unsigned char* p)
+	{
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+	}
+
+	inline unsigned int readBE16(const unsigned char* p)
+	{
+		return ((unsigned int)p[0] << 8) | p[1];
+	}
+
+	//LSB first bit reader over the deflate stream; reading past the end yields zeros, see overrun()
+	struct BitReader
+	{
+		const unsigned char* bytes;
+		size_t size;
+		size_t pos;
+		uint64_t buffer;
+		unsigned int count;
+
+		BitReader(const unsigned char* bytes, size_t size) : bytes(bytes), size(size), pos(0), buffer(0), count(0) {}
+
+		inline void refill()
+		{
+			while (count <= 56)
+			{
+				if (pos < size)
+					buffer |= (uint64_t)bytes[pos] << count;
+				pos++;
+				count += 8;
+			}
+		}
+
+		//true once more bits were consumed than the stream holds
+		inline bool overrun() const
+		{
+			return pos * 8 - count > size * 8;
+		}
+
+		inline unsigned int peek(unsigned int bits)
+		{
+			if (count < bits)
+				refill();
+			return (unsigned int)(buffer & ((1ull << bits) - 1));
+		}
+
+		inline void consume(unsigned int bits)
+		{
+			buffer >>= bits;
+			count -= bits;
+		}
+
+		inline unsigned int read(unsigned int bits)
+		{
+			if (bits == 0)
+				return 0;
+			unsigned int value = peek(bits);
+			consume(bits);
+			return value;
+		}
+
+		void alignToByte()
+		{
+			consume(count % 8);
+		}
+	};
+
+	//Canonical Huffman table: a 10 bit lookup for the common short codes,
+	//longer codes are walked bit by bit through the per length counts
+	struct Huffman
+	{
+		static const unsigned int FAST_BITS = 10;
+
+		unsigned short counts[16];
+		unsigned short symbols[288];
+		unsigned short fast[1 << FAST_BITS];
+
+		bool build(const unsigned char* lengths, unsigned int n)
+		{
+			memset(counts, 0, sizeof(counts));
+			memset(fast, 0, sizeof(fast));
+			for (unsigned int i = 0; i < n; i++)
+				counts[lengths[i]]++;
+			counts[0] = 0;
+
+			//over subscribed sets are corrupt, incomplete ones are allowed (single distance codes)
+			int left = 1;
+			for (int len = 1; len < 16; len++)
+			{
+				left = left * 2 - counts[len];
+				if (left < 0)
+					return false;
+			}
+
+			unsigned short offsets[16];
+			offsets[1] = 0;
+			for (int len = 1; len < 15; len++)
+				offsets[len + 1] = offsets[len] + counts[len];
+			for (unsigned int i = 0; i < n; i++)
+				if (lengths[i] != 0)
+					symbols[offsets[lengths[i]]++] = (unsigned short)i;
+
+			//codes are stored MSB first in an LSB first stream, so the table is indexed by reversed codes
+			unsigned int code = 0, index = 0;
+			for (unsigned int len = 1; len <= FAST_BITS; len++)
+			{
+				for (unsigned int i = 0; i < counts[len]; i++, code++, index++)
+				{
+					unsigned int reversed = 0;
+					for (unsigned int b = 0; b < len; b++)
+						reversed |= ((code >> b) & 1) << (len - 1 - b);
+
+					for (unsigned int fill = reversed; fill < (1u << FAST_BITS); fill += 1u << len)
+						fast[fill] = (unsigned short)((len << 9) | symbols[index]);
+				}
+				code <<= 1;
+			}
+
+			return true;
+		}
+
+		inline int decode(BitReader &in) const
+		{
+			unsigned short entry = fast[in.peek(FAST_BITS)];
+			if (entry != 0)
+			{
+				in.consume(entry >> 9);
+				return entry & 511;
+			}
+
+			int code = 0, first = 0, index = 0;
+			for (int len = 1; len < 16; len++)
+			{
+				code |= in.read(1);
+				int count = counts[len];
+				if (code - count < first)
+					return symbols[index + (code - first)];
+				index += count;
+				first += count;
+				first <<= 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+	};
+
+	const unsigned short LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned char LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const unsigned short DIST_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const unsigned char DIST_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	bool inflateBlock(BitReader &in, const Huffman &lengths, const Huffman &distances, std::vector<unsigned char> &out, size_t maxSize)
+	{
+		while (true)
+		{
+			int symbol = lengths.decode(in);
+			if (symbol < 0 || in.overrun())
+				return false;
+
+			if (symbol < 256)
+			{
+				if (out.size() >= maxSize)
+					return false;
+				out.push_back((unsigned char)symbol);
+				continue;
+			}
+			if (symbol == 256)
+				return true;
+
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			size_t length = LENGTH_BASE[symbol] + in.read(LENGTH_EXTRA[symbol]);
+
+			int distanceSymbol = distances.decode(in);
+			if (distanceSymbol < 0 || distanceSymbol >= 30)
+				return false;
+			size_t distance = DIST_BASE[distanceSymbol] + in.read(DIST_EXTRA[distanceSymbol]);
+
+			if (distance > out.size() || out.size() + length > maxSize)
+				return false;
+
+			//matches may overlap their own output, so copy forwards one byte at a time
+			size_t from = out.size() - distance;
+			size_t to = out.size();
+			out.resize(to + length);
+			unsigned char* data = out.data();
+			for (size_t i = 0; i < length; i++)
+				data[to + i] = data[from + i];
+		}
+	}
+
+	bool readDynamicTables(BitReader &in, Huffman &lengths, Huffman &distances)
+	{
+		static const unsigned char ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		unsigned int literalCount = in.read(5) + 257;
+		unsigned int distanceCount = in.read(5) + 1;
+		unsigned int codeCount = in.read(4) + 4;
+		if (literalCount > 286 || distanceCount > 30)
+			return false;
+
+		unsigned char codeLengths[19] = {};
+		for (unsigned int i = 0; i < codeCount; i++)
+			codeLengths[ORDER[i]] = (unsigned char)in.read(3);
+
+		Huffman codeTable;
+		if (!codeTable.build(codeLengths, 19))
+			return false;
+
+		unsigned char all[286 + 30] = {};
+		unsigned int n = 0;
+		while (n < literalCount + distanceCount)
+		{
+			int symbol = codeTable.decode(in);
+			if (symbol < 0 || in.overrun())
+				return false;
+
+			if (symbol < 16)
+			{
+				all[n++] = (unsigned char)symbol;
+				continue;
+			}
+
+			unsigned char value = 0;
+			unsigned int repeat;
+			if (symbol == 16)
+			{
+				if (n == 0)
+					return false;
+				value = all[n - 1];
+				repeat = 3 + in.read(2);
+			}
+			else if (symbol == 17)
+				repeat = 3 + in.read(3);
+			else
+				repeat = 11 + in.read(7);
+
+			if (n + repeat > literalCount + distanceCount)
+				return false;
+			while (repeat--)
+				all[n++] = value;
+		}
+
+		if (all[256] == 0)
+			return false;
+
+		return lengths.build(all, literalCount) && distances.build(all + literalCount, distanceCount);
+	}
+
+	inline unsigned char paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = p > a ? p - a : a - p;
+		int pb = p > b ? p - b : b - p;
+		int pc = p > c ? p - c : c - p;
+		if (pa <= pb && pa <= pc)
+			return (unsigned char)a;
+		return (unsigned char)(pb <= pc ? b : c);
+	}
+
+	//reverses the per row filters in place, rows are (1 + rowBytes) long with the filter type first
+	bool unfilter(unsigned char* data, unsigned int height, size_t rowBytes, unsigned int bytesPerPixel)
+	{
+		const unsigned char* previous = nullptr;
+		for (unsigned int y = 0; y < height; y++)
+		{
+			unsigned char filter = data[y * (rowBytes + 1)];
+			unsigned char* row = data + y * (rowBytes + 1) + 1;
+
+			switch (filter)
+			{
+			case 0:
+				break;
+			case 1:
+				for (size_t i = bytesPerPixel; i < rowBytes; i++)
+					row[i] += row[i - bytesPerPixel];
+				break;
+			case 2:
+				if (previous)
+					for (size_t i = 0; i < rowBytes; i++)
+						row[i] += previous[i];
+				break;
+			case 3:
+				for (size_t i = 0; i < rowBytes; i++)
+				{
+					int left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+					int up = previous ? previous[i] : 0;
+					row[i] += (unsigned char)((left + up) / 2);
+				}
+				break;
+			case 4:
+				for (size_t i = 0; i < rowBytes; i++)
+				{
+					int left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+					int up = previous ? previous[i] : 0;
+					int upLeft = (previous && i >= bytesPerPixel) ? previous[i - bytesPerPixel] : 0;
+					row[i] += paeth(left, up, upLeft);
+				}
+				break;
+			default:
+				return false;
+			}
+
+			previous = row;
+		}
+		return true;
+	}
+
+	//sample x of a row packed at bitDepth bits per sample, 16 bit samples keep their high byte
+	inline unsigned int sample(const unsigned char* row, size_t x, unsigned int bitDepth)
+	{
+		switch (bitDepth)
+		{
+		case 8: return row[x];
+		case 16: return row[x * 2];
+		default:
+		{
+			size_t bit = x * bitDepth;
+			unsigned int shift = 8 - bitDepth - (unsigned int)(bit % 8);
+			return (row[bit / 8] >> shift) & ((1u << bitDepth) - 1);
+		}
+		}
+	}
+
+	//the sample at its full bit depth, which is what a tRNS colour key is compared against
+	inline unsigned int fullSample(const unsigned char* row, size_t x, unsigned int bitDepth)
+	{
+		return bitDepth == 16 ? readBE16(row + x * 2) : sample(row, x, bitDepth);
+	}
+}
+
+bool inflateZlib(const unsigned char* bytes, size_t size, std::vector<unsigned char> &out, size_t maxSize)
+{
+	if (size < 2)
+		return false;
+
+	//CM 8 (deflate), header checksum, no preset dictionary
+	if ((bytes[0] & 0x0F) != 8 || ((bytes[0] << 8) | bytes[1]) % 31 != 0 || (bytes[1] & 0x20))
+		return false;
+
+	BitReader in(bytes + 2, size - 2);
+
+	bool last = false;
+	while (!last)
+	{
+		last = in.read(1) != 0;
+		unsigned int type = in.read(2);
+
+		if (type == 0)
+		{
+			//stored: byte aligned LEN, NLEN, then raw bytes
+			in.alignToByte();
+			unsigned int length = in.read(16);
+			unsigned int inverse = in.read(16);
+			if ((length ^ 0xFFFF) != inverse || out.size() + length > maxSize)
+				return false;
+			for (unsigned int i = 0; i < length; i++)
+				out.push_back((unsigned char)in.read(8));
+		}
+		else if (type == 1)
+		{
+			static Huffman fixedLengths, fixedDistances;
+			static bool fixedBuilt = [] {
+				unsigned char lengths[288];
+				memset(lengths, 8, 144);
+				memset(lengths + 144, 9, 112);
+				memset(lengths + 256, 7, 24);
+				memset(lengths + 280, 8, 8);
+				unsigned char distances[30];
+				memset(distances, 5, 30);
+				return fixedLengths.build(lengths, 288) && fixedDistances.build(distances, 30);
+			}();
+
+			if (!fixedBuilt || !inflateBlock(in, fixedLengths, fixedDistances, out, maxSize))
+				return false;
+		}
+		else if (type == 2)
+		{
+			Huffman lengths, distances;
+			if (!readDynamicTables(in, lengths, distances) || !inflateBlock(in, lengths, distances, out, maxSize))
+				return false;
+		}
+		else
+			return false;
+
+		if (in.overrun())
+			return false;
+	}
+
+	return true;
+}
+
+bool decodePNG(const unsigned char* bytes, size_t size, Image &image, const char* name)
+{
+	if (size < 8 || memcmp(bytes, PNG_SIGNATURE, 8) != 0)
+	{
+		printf("%s is not a PNG file\n", name);
+		return false;
+	}
+
+	unsigned int width = 0, height = 0, bitDepth = 0, colorType = 0, interlace = 0;
+	unsigned char palette[256][4];
+	unsigned int paletteSize = 0;
+	bool transparency = false;
+	//grey (type 0) and RGB (type 2) images mark one colour as fully transparent instead
+	unsigned int colorKey[3] = { 0, 0, 0 };
+	bool colorKeyed = false;
+	std::vector<unsigned char> compressed;
+
+	//walk the chunks, collecting IHDR, PLTE, tRNS and the IDAT stream
+	size_t pos = 8;
+	while (pos + 12 <= size)
+	{
+		uint32_t length = readBE32(bytes + pos);
+		const unsigned char* type = bytes + pos + 4;
+		const unsigned char* data = bytes + pos + 8;
+		if (length > size - pos - 12)
+			break;
+
+		if (memcmp(type, "IHDR", 4) == 0 && length >= 13)
+		{
+			width = readBE32(data);
+			height = readBE32(data + 4);
+			bitDepth = data[8];
+			colorType = data[9];
+			interlace = data[12];
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			paletteSize = length / 3 > 256 ? 256 : length / 3;
+			for (unsigned int i = 0; i < paletteSize; i++)
+			{
+				palette[i][0] = data[i * 3 + 0];
+				palette[i][1] = data[i * 3 + 1];
+				palette[i][2] = data[i * 3 + 2];
+				palette[i][3] = 255;
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0 && colorType == 3)
+		{
+			for (unsigned int i = 0; i < length && i < 256; i++)
+				palette[i][3] = data[i];
+			transparency = true;
+		}
+		else if (memcmp(type, "tRNS", 4) == 0 && colorType == 0 && length >= 2)
+		{
+			colorKey[0] = readBE16(data);
+			colorKeyed = true;
+		}
+		else if (memcmp(type, "tRNS", 4) == 0 && colorType == 2 && length >= 6)
+		{
+			for (int c = 0; c < 3; c++)
+				colorKey[c] = readBE16(data + c * 2);
+			colorKeyed = true;
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+			compressed.insert(compressed.end(), data, data + length);
+		else if (memcmp(type, "IEND", 4) == 0)
+			break;
+
+		pos += 12 + (size_t)length;
+	}
+
+	static const unsigned int CHANNELS[7] = { 1, 0, 3, 1, 2, 0, 4 };
+	if (width == 0 || height == 0 || width > MAX_PNG_DIMENSION || height > MAX_PNG_DIMENSION || colorType > 6 || CHANNELS[colorType] == 0 ||
+		(bitDepth != 1 && bitDepth != 2 && bitDepth != 4 && bitDepth != 8 && bitDepth != 16) ||
+		(colorType == 3 && (bitDepth == 16 || paletteSize == 0)))
+	{
+		printf("%s: unsupported PNG header\n", name);
+		return false;
+	}
+	if (interlace != 0)
+	{
+		printf("%s: interlaced PNGs are not supported\n", name);
+		return false;
+	}
+
+	unsigned int channels = CHANNELS[colorType];
+	size_t rowBytes = ((size_t)width * channels * bitDepth + 7) / 8;
+	unsigned int bytesPerPixel = (channels * bitDepth + 7) / 8;
+	size_t expected = (rowBytes + 1) * height;
+
+	std::vector<unsigned char> raw;
+	raw.reserve(expected);
+	if (!inflateZlib(compressed.data(), compressed.size(), raw, expected) || raw.size() != expected)
+	{
+		printf("%s: corrupt PNG data\n", name);
+		return false;
+	}
+
+	if (!unfilter(raw.data(), height, rowBytes, bytesPerPixel))
+	{
+		printf("%s: corrupt PNG filter\n", name);
+		return false;
+	}
+
+	bool alpha = colorType == 4 || colorType == 6 || (colorType == 3 && transparency) || colorKeyed;
+	unsigned int outChannels = alpha ? 4 : 3;
+
+	image.width = width;
+	image.height = height;
+	image.format = alpha ? GL_RGBA : GL_RGB;
+	image.pixels.resize((size_t)width * height * outChannels);
+
+	//grey samples below 8 bits are stretched to the full range
+	unsigned int greyScale = bitDepth < 8 ? 255 / ((1u << bitDepth) - 1) : 1;
+
+	for (unsigned int y = 0; y < height; y++)
+	{
+		//PNG stores the top row first
+		const unsigned char* row = raw.data() + (size_t)y * (rowBytes + 1) + 1;
+		unsigned char* out = image.pixels.data() + (size_t)(height - 1 - y) * width * outChannels;
+
+		if (bitDepth == 8 && channels == outChannels)
+		{
+			memcpy(out, row, (size_t)width * outChannels);
+			continue;
+		}
+
+		for (unsigned int x = 0; x < width; x++, out += outChannels)
+		{
+			switch (colorType)
+			{
+			case 0:
+				out[0] = out[1] = out[2] = (unsigned char)(sample(row, x, bitDepth) * greyScale);
+				if (colorKeyed)
+					out[3] = fullSample(row, x, bitDepth) == colorKey[0] ? 0 : 255;
+				break;
+			case 2:
+				out[0] = (unsigned char)sample(row, x * 3 + 0, bitDepth);
+				out[1] = (unsigned char)sample(row, x * 3 + 1, bitDepth);
+				out[2] = (unsigned char)sample(row, x * 3 + 2, bitDepth);
+				if (colorKeyed)
+				{
+					bool key = fullSample(row, x * 3 + 0, bitDepth) == colorKey[0] &&
+						fullSample(row, x * 3 + 1, bitDepth) == colorKey[1] &&
+						fullSample(row, x * 3 + 2, bitDepth) == colorKey[2];
+					out[3] = key ? 0 : 255;
+				}
+				break;
+			case 3:
+			{
+				unsigned int index = sample(row, x, bitDepth);
+				const unsigned char* entry = palette[index < paletteSize ? index : 0];
+				memcpy(out, entry, outChannels);
+				break;
+			}
+			case 4:
+				out[0] = out[1] = out[2] = (unsigned char)sample(row, x * 2, bitDepth);
+				out[3] = (unsigned char)sample(row, x * 2 + 1, bitDepth);
+				break;
+			case 6:
+				for (int c = 0; c < 4; c++)
+					out[c] = (unsigned char)sample(row, x * 4 + c, bitDepth);
+				break;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+#include "texture.h"
+
+//PNG decoder for the texture pipeline, no external libraries.
+//Handles every non-interlaced color type (grey, RGB, palette, grey + alpha, RGBA) at 1 to 16 bits.
+//The result is GL_RGB, or GL_RGBA when the image carries alpha (an alpha channel, palette
+//transparency or a tRNS colour key on grey and RGB images), 8 bits per channel,
+//rows flipped to bottom first like decodeBMP. Safe to call from worker threads.
+bool decodePNG(const unsigned char* bytes, size_t size, Image &image, const char* name);
+
+//zlib stream (deflate with a 2 byte header) into out; false on corrupt data or output past maxSize
+bool inflateZlib(const unsigned char* bytes, size_t size, std::vector<unsigned char> &out, size_t maxSize);
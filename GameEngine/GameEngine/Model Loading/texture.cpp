@@ -1,70 +1,150 @@
 #include "texture.h"
+#include "textureLoader.h"
+#include "..\Assets\vfs.h"
+#include "pngDecoder.h"
+#include <cstring>
 #include <iostream>
 
+TextureResource::~TextureResource()
+{
+	//layers leave the array texture to its own resource
+	if (id != 0 && !array)
+		glDeleteTextures(1, &id);
+}
+
+GLuint loadImage(const char * imagepath) {
+
+	TextureData data;
+	if (!TextureLoader::readTexture(imagepath, data))
+	{
+		getchar();
+		return 0;
+	}
+
+	// Create OpenGL texture
+	GLuint textureID;
+	glGenTextures(1, &textureID);
+
+	TextureLoader::upload(textureID, data);
+
+	// Return the ID of the texture
+	return textureID;
+}
+
 GLuint loadBMP(const char * imagepath) {
 
-	printf("Reading image %s\n", imagepath);
+	return loadImage(imagepath);
+}
 
-	unsigned char header[54];
-	unsigned int dataPos;
-	unsigned int imageSize;
-	unsigned int width, height;
+static unsigned int readU16(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8);
+}
 
-	unsigned char * data;
+static unsigned int readU32(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
 
-	FILE * file;
-	errno_t err = fopen_s(&file, imagepath, "rb");
-	if (err)
-	{
-		printf("%s could not be opened.", imagepath); getchar(); return 0;
-	}
+ImageFormat detectImageFormat(const unsigned char* bytes, size_t size) {
 
-	if (fread(header, 1, 54, file) != 54) {
-		printf("Not a correct BMP file\n");
-		return 0;
-	}
+	static const unsigned char PNG_MAGIC[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
 
-	// Parsing BMP file
-	if (header[0] != 'B' || header[1] != 'M') {
-		printf("Not a correct BMP file\n");
-		return 0;
+	if (size >= 8 && memcmp(bytes, PNG_MAGIC, 8) == 0)
+		return ImageFormat::Png;
+	if (size >= 2 && bytes[0] == 'B' && bytes[1] == 'M')
+		return ImageFormat::Bmp;
+	return ImageFormat::Unknown;
+}
+
+bool decodeImage(const unsigned char* bytes, size_t size, Image &image, const char * name) {
+
+	// the extension is not trusted, the first bytes decide the decoder
+	switch (detectImageFormat(bytes, size))
+	{
+	case ImageFormat::Bmp:
+		return decodeBMP(bytes, size, image, name);
+	case ImageFormat::Png:
+		return decodePNG(bytes, size, image, name);
+	default:
+		printf("%s: unknown image format\n", name);
+		return false;
 	}
+}
 
-	if (*(int*)&(header[0x1E]) != 0) { printf("Not a correct BMP file\n");    return 0; }
-	if (*(int*)&(header[0x1C]) != 24) { printf("Not a correct BMP file\n");    return 0; }
+bool decodeImage(const char * imagepath, Image &image) {
 
-	dataPos = *(int*)&(header[0x0A]);
-	imageSize = *(int*)&(header[0x22]);
-	width = *(int*)&(header[0x12]);
-	height = *(int*)&(header[0x16]);
+	printf("Reading image %s\n", imagepath);
 
-	if (imageSize == 0)    imageSize = width*height * 3; 
-	if (dataPos == 0)      dataPos = 54; 
+	VfsFile file(imagepath);
+	if (!file.isOpen())
+	{
+		printf("%s could not be opened.\n", imagepath); return false;
+	}
 
-										
-	data = new unsigned char[imageSize];
+	return decodeImage((const unsigned char*)file.data(), file.size(), image, imagepath);
+}
 
-	// Read data into buffer
-	fread(data, 1, imageSize, file);
+bool decodeBMP(const char * imagepath, Image &image) {
 
-	fclose(file);
+	VfsFile file(imagepath);
+	if (!file.isOpen())
+	{
+		printf("%s could not be opened.\n", imagepath); return false;
+	}
 
-	// Create OpenGL texture
-	GLuint textureID;
-	glGenTextures(1, &textureID);
+	return decodeBMP((const unsigned char*)file.data(), file.size(), image, imagepath);
+}
+
+bool decodeBMP(const unsigned char* bytes, size_t size, Image &image, const char * imagepath) {
 
-	glBindTexture(GL_TEXTURE_2D, textureID);
+	// Parsing BMP file: 14 byte file header, then at least a BITMAPINFOHEADER
+	if (size < 54 || bytes[0] != 'B' || bytes[1] != 'M' || readU32(bytes + 14) < 40) {
+		printf("Not a correct BMP file\n");
+		return false;
+	}
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
+	unsigned int dataPos = readU32(bytes + 10);
+	int width = (int)readU32(bytes + 18);
+	int height = (int)readU32(bytes + 22);
+	unsigned int bitsPerPixel = readU16(bytes + 28);
+	unsigned int compression = readU32(bytes + 30);
+
+	if (bitsPerPixel != 24 && bitsPerPixel != 32) { printf("%s: only 24 and 32 bit BMPs are supported\n", imagepath); return false; }
+
+	// 32 bit images may describe their channels with masks, only plain BGRA is accepted
+	bool bitfields = bitsPerPixel == 32 && compression == 3 && size >= 66 &&
+		readU32(bytes + 54) == 0x00FF0000 && readU32(bytes + 58) == 0x0000FF00 && readU32(bytes + 62) == 0x000000FF;
+	if (compression != 0 && !bitfields) { printf("%s: compressed BMPs are not supported\n", imagepath); return false; }
+
+	// a negative height means the rows are stored top to bottom
+	bool topDown = height < 0;
+	if (topDown)
+		height = -height;
+	if (width <= 0 || height <= 0) { printf("Not a correct BMP file\n"); return false; }
+
+	if (dataPos == 0)      dataPos = 54;
+
+	// rows are padded to 4 bytes in the file
+	unsigned int channels = bitsPerPixel / 8;
+	size_t rowBytes = (size_t)width * channels;
+	size_t stride = (rowBytes + 3) & ~(size_t)3;
+	if (dataPos + stride * height > size) {
+		printf("%s is truncated\n", imagepath);
+		return false;
+	}
 
-	delete[] data;
+	image.width = width;
+	image.height = height;
+	image.format = channels == 4 ? GL_BGRA : GL_BGR;
+	image.pixels.resize(rowBytes * height);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glGenerateMipmap(GL_TEXTURE_2D);
+	// Copy the rows out of the mapping, bottom row first like GL expects
+	for (int y = 0; y < height; y++)
+	{
+		int sourceRow = topDown ? height - 1 - y : y;
+		memcpy(image.pixels.data() + rowBytes * y, bytes + dataPos + stride * sourceRow, rowBytes);
+	}
 
-	// Return the ID of the texture
-	return textureID;
-}
\ No newline at end of file
+	return true;
+}
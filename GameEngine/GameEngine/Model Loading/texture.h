@@ -1,5 +1,64 @@
 #pragma once
 #include <glew.h>
 #include <glfw3.h>
+#include <vector>
+#include <memory>
 
+//Decoded pixels waiting to be cooked, filled on any thread.
+//Rows are tightly packed, bottom row first, 8 bits per channel. format is GL_BGR or GL_BGRA
+//for BMPs (decodeBMP) and GL_RGB or GL_RGBA for PNGs (decodePNG).
+struct Image
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+	GLenum format = GL_BGR;
+	std::vector<unsigned char> pixels;
+};
+
+//GL texture owned through a shared_ptr, deleted with its last owner.
+//After TexturePacker moves it into a GL_TEXTURE_2D_ARRAY, id names the array,
+//layer is its slice and array keeps the shared array texture alive.
+struct TextureResource
+{
+	GLuint id = 0;
+	size_t residentBytes = 0;
+
+	GLenum target = GL_TEXTURE_2D;
+	int layer = -1;
+	std::shared_ptr<TextureResource> array;
+
+	//what was uploaded, used to find textures that can share an array
+	GLenum internalFormat = 0;
+	unsigned int width = 0;
+	unsigned int height = 0;
+	unsigned int levelCount = 0;
+
+	TextureResource() {}
+	~TextureResource();
+
+	TextureResource(const TextureResource&) = delete;
+	TextureResource& operator=(const TextureResource&) = delete;
+};
+
+enum class ImageFormat
+{
+	Unknown,
+	Bmp,
+	Png
+};
+
+//Loads a BMP or PNG through TextureLoader, so the cooked .mawtex is used when it is up to date
+GLuint loadImage(const char * imagepath);
+//kept for existing callers, same as loadImage
 GLuint loadBMP(const char * imagepath);
+
+//Front end of the texture pipeline: picks the decoder from the magic bytes, not the extension.
+//Every decoder fills the same Image, which TextureCooker consumes for both the synchronous
+//(loadImage) and the worker thread (AssetLoader) paths. Safe to call from worker threads.
+ImageFormat detectImageFormat(const unsigned char* bytes, size_t size);
+bool decodeImage(const unsigned char* bytes, size_t size, Image &image, const char * name);
+bool decodeImage(const char * imagepath, Image &image);
+
+//Raw pixels of a 24 or 32 bit BMP, read through a file mapping or from bytes already in memory
+bool decodeBMP(const char * imagepath, Image &image);
+bool decodeBMP(const unsigned char* bytes, size_t size, Image &image, const char * imagepath);
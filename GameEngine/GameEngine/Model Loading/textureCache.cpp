@@ -0,0 +1,136 @@
+#include "textureCache.h"
+#include <atomic>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+static const char TEXTURE_CACHE_MAGIC[4] = { 'M', 'A', 'W', 'T' };
+static const uint64_t TEXTURE_CACHE_ALIGNMENT = 64;
+
+static uint64_t alignUp(uint64_t value)
+{
+	return (value + TEXTURE_CACHE_ALIGNMENT - 1) & ~(TEXTURE_CACHE_ALIGNMENT - 1);
+}
+
+std::string TextureCache::pathFor(const std::string &imagePath)
+{
+	size_t dot = imagePath.find_last_of('.');
+	size_t slash = imagePath.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		return imagePath + ".mawtex";
+
+	return imagePath.substr(0, dot) + ".mawtex";
+}
+
+bool TextureCache::write(const std::string &path, uint64_t sourceHash, const CookedTexture &cooked)
+{
+	TextureCacheHeader h;
+	memcpy(h.magic, TEXTURE_CACHE_MAGIC, 4);
+	h.version = VERSION;
+	h.sourceHash = sourceHash;
+	h.format = cooked.format;
+	h.levelCount = (uint32_t)cooked.levels.size();
+	h.levelStride = sizeof(TextureLevel);
+	h.reserved = 0;
+	h.levelOffset = alignUp(sizeof(TextureCacheHeader));
+	h.dataOffset = alignUp(h.levelOffset + (uint64_t)h.levelCount * h.levelStride);
+	h.dataSize = cooked.data.size();
+
+	//same temporary name + rename dance as MeshCache::write
+	static std::atomic<unsigned int> tempCounter(0);
+	std::string tempPath = path + ".tmp" + std::to_string(tempCounter++);
+	std::ofstream out(tempPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.good())
+		return false;
+
+	static const char padding[TEXTURE_CACHE_ALIGNMENT] = {};
+
+	out.write((const char*)&h, sizeof(h));
+	out.write(padding, h.levelOffset - sizeof(h));
+	out.write((const char*)cooked.levels.data(), (std::streamsize)h.levelCount * h.levelStride);
+	out.write(padding, h.dataOffset - (h.levelOffset + (uint64_t)h.levelCount * h.levelStride));
+	out.write((const char*)cooked.data.data(), (std::streamsize)h.dataSize);
+	out.close();
+
+	if (!out.good())
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	std::remove(path.c_str());
+	if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	//a packed copy of this cache is out of date now
+	Vfs::preferLoose(path);
+	return true;
+}
+
+bool TextureCache::open(const std::string &path, uint64_t sourceHash)
+{
+	header = nullptr;
+	if (!file.open(path))
+		return false;
+
+	//a rejected cache is unmapped right away: the caller rewrites the same file next,
+	//and Windows refuses to replace a file that is still mapped
+	if (!validate(sourceHash))
+	{
+		file.close();
+		return false;
+	}
+
+	header = (const TextureCacheHeader*)file.data();
+	return true;
+}
+
+bool TextureCache::validate(uint64_t sourceHash) const
+{
+	if (file.size() < sizeof(TextureCacheHeader))
+		return false;
+
+	const TextureCacheHeader* h = (const TextureCacheHeader*)file.data();
+	if (memcmp(h->magic, TEXTURE_CACHE_MAGIC, 4) != 0 || h->version != VERSION || h->sourceHash != sourceHash)
+		return false;
+
+	if (h->levelStride != sizeof(TextureLevel) || h->levelCount == 0)
+		return false;
+
+	if (h->levelOffset + (uint64_t)h->levelCount * h->levelStride > file.size() ||
+		h->dataOffset + h->dataSize > file.size())
+		return false;
+
+	//every level has to stay inside the pixel blob
+	const TextureLevel* levels = (const TextureLevel*)(file.data() + h->levelOffset);
+	for (uint32_t i = 0; i < h->levelCount; i++)
+	{
+		if (levels[i].offset + levels[i].size > h->dataSize || levels[i].width == 0 || levels[i].height == 0)
+			return false;
+	}
+
+	return true;
+}
+
+uint32_t TextureCache::getFormat() const
+{
+	return header->format;
+}
+
+const TextureLevel* TextureCache::getLevels() const
+{
+	return (const TextureLevel*)(file.data() + header->levelOffset);
+}
+
+unsigned int TextureCache::getLevelCount() const
+{
+	return header->levelCount;
+}
+
+const unsigned char* TextureCache::getData() const
+{
+	return (const unsigned char*)(file.data() + header->dataOffset);
+}
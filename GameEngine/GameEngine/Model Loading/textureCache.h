@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "textureCooker.h"
+#include "..\Assets\vfs.h"
+
+//Cooked texture file (.mawtex) written next to each image.
+//Layout: TextureCacheHeader, then the level table and the pixel blob holding every mip level
+//in its GPU format, each starting on a 64 byte boundary, so levels upload straight from the mapping.
+struct TextureCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceHash;
+	uint32_t format;
+	uint32_t levelCount;
+	uint32_t levelStride;
+	uint32_t reserved;
+	uint64_t levelOffset;
+	uint64_t dataOffset;
+	uint64_t dataSize;
+};
+
+class TextureCache
+{
+	public:
+		//bump when the cooked output changes (filter, encoder, ...)
+		static const uint32_t VERSION = 1;
+
+		static std::string pathFor(const std::string &imagePath);
+		static bool write(const std::string &path, uint64_t sourceHash, const CookedTexture &cooked);
+
+		//maps the cache, false if it is missing, corrupt or cooked from different source bytes
+		bool open(const std::string &path, uint64_t sourceHash);
+
+		uint32_t getFormat() const;
+		const TextureLevel* getLevels() const;
+		unsigned int getLevelCount() const;
+		const unsigned char* getData() const;
+
+	private:
+		//checks the mapped header and ranges against the source
+		bool validate(uint64_t sourceHash) const;
+
+		VfsFile file;
+		const TextureCacheHeader* header = nullptr;
+};
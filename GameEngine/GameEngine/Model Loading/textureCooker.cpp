@@ -0,0 +1,367 @@
+#include "textureCooker.h"
+#include "textureLoader.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+	inline unsigned short to565(const float c[3])
+	{
+		int r = std::max(0, std::min(31, (int)(c[0] * 31.0f / 255.0f + 0.5f)));
+		int g = std::max(0, std::min(63, (int)(c[1] * 63.0f / 255.0f + 0.5f)));
+		int b = std::max(0, std::min(31, (int)(c[2] * 31.0f / 255.0f + 0.5f)));
+		return (unsigned short)((r << 11) | (g << 5) | b);
+	}
+
+	inline void from565(unsigned short c, int rgb[3])
+	{
+		int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	//the four colours a pair of endpoints stands for in opaque (c0 > c1) mode
+	void palette(unsigned short c0, unsigned short c1, int colors[4][3])
+	{
+		from565(c0, colors[0]);
+		from565(c1, colors[1]);
+		for (int k = 0; k < 3; k++)
+		{
+			colors[2][k] = (2 * colors[0][k] + colors[1][k]) / 3;
+			colors[3][k] = (colors[0][k] + 2 * colors[1][k]) / 3;
+		}
+	}
+
+	//nearest palette entry per pixel, returns the summed squared error
+	int assign(const int pixels[16][3], const int colors[4][3], unsigned int &selectors)
+	{
+		int error = 0;
+		selectors = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestDistance = INT32_MAX;
+			for (int p = 0; p < 4; p++)
+			{
+				int dr = pixels[i][0] - colors[p][0], dg = pixels[i][1] - colors[p][1], db = pixels[i][2] - colors[p][2];
+				int distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			selectors |= best << (i * 2);
+			error += bestDistance;
+		}
+		return error;
+	}
+
+	void writeBlock(unsigned char* block, unsigned short c0, unsigned short c1, unsigned int selectors)
+	{
+		block[0] = c0 & 0xFF;
+		block[1] = c0 >> 8;
+		block[2] = c1 & 0xFF;
+		block[3] = c1 >> 8;
+		block[4] = selectors & 0xFF;
+		block[5] = (selectors >> 8) & 0xFF;
+		block[6] = (selectors >> 16) & 0xFF;
+		block[7] = selectors >> 24;
+	}
+
+	//Principal axis endpoints, then one least squares refit of the endpoints to the chosen selectors
+	void compressBlock(const int pixels[16][3], unsigned char* block)
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+			for (int k = 0; k < 3; k++)
+				mean[k] += pixels[i][k] / 16.0f;
+
+		float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float r = pixels[i][0] - mean[0], g = pixels[i][1] - mean[1], b = pixels[i][2] - mean[2];
+			cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+			cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+		}
+
+		//power iteration for the main direction of the colours
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+			float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+			float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+			float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+			if (length <= 0.0f)
+				break;
+			axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+		}
+
+		float minProjection = 1e30f, maxProjection = -1e30f;
+		int minPixel = 0, maxPixel = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			float projection = pixels[i][0] * axis[0] + pixels[i][1] * axis[1] + pixels[i][2] * axis[2];
+			if (projection < minProjection) { minProjection = projection; minPixel = i; }
+			if (projection > maxProjection) { maxProjection = projection; maxPixel = i; }
+		}
+
+		float high[3], low[3];
+		for (int k = 0; k < 3; k++)
+		{
+			high[k] = (float)pixels[maxPixel][k];
+			low[k] = (float)pixels[minPixel][k];
+		}
+
+		unsigned short c0 = to565(high), c1 = to565(low);
+		int colors[4][3];
+		unsigned int selectors;
+
+		if (c0 == c1)
+		{
+			writeBlock(block, c0, c1, 0);
+			return;
+		}
+		if (c0 < c1)
+			std::swap(c0, c1);
+
+		palette(c0, c1, colors);
+		int error = assign(pixels, colors, selectors);
+
+		//refit: pixel i ~ a * w0 + b * w1 with w the palette weight of its selector
+		static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float w = weights[(selectors >> (i * 2)) & 3], v = 1.0f - w;
+			aa += w * w; bb += v * v; ab += w * v;
+			for (int k = 0; k < 3; k++)
+			{
+				ax[k] += w * pixels[i][k];
+				bx[k] += v * pixels[i][k];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) > 1e-6f)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				high[k] = (ax[k] * bb - bx[k] * ab) / determinant;
+				low[k] = (bx[k] * aa - ax[k] * ab) / determinant;
+			}
+
+			unsigned short r0 = to565(high), r1 = to565(low);
+			if (r0 < r1)
+				std::swap(r0, r1);
+
+			if (r0 != r1)
+			{
+				int refitted[4][3];
+				unsigned int refittedSelectors;
+				palette(r0, r1, refitted);
+				if (assign(pixels, refitted, refittedSelectors) < error)
+				{
+					c0 = r0;
+					c1 = r1;
+					selectors = refittedSelectors;
+				}
+			}
+		}
+
+		writeBlock(block, c0, c1, selectors);
+	}
+}
+
+void TextureCooker::toRGB(const Image &image, std::vector<unsigned char> &rgb)
+{
+	//alpha is dropped, the BC1 output is opaque
+	size_t channels = (image.format == GL_BGRA || image.format == GL_RGBA) ? 4 : 3;
+	size_t stride = (size_t)image.width * channels;
+	bool bgr = image.format == GL_BGR || image.format == GL_BGRA;
+
+	rgb.resize((size_t)image.width * image.height * 3);
+	for (unsigned int y = 0; y < image.height; y++)
+	{
+		const unsigned char* row = image.pixels.data() + y * stride;
+		unsigned char* out = rgb.data() + (size_t)y * image.width * 3;
+		if (y * stride + (size_t)image.width * 3 > image.pixels.size())
+		{
+			memset(out, 0, (size_t)image.width * 3);
+			continue;
+		}
+
+		for (unsigned int x = 0; x < image.width; x++)
+		{
+			out[x * 3 + 0] = row[x * channels + (bgr ? 2 : 0)];
+			out[x * 3 + 1] = row[x * channels + 1];
+			out[x * 3 + 2] = row[x * channels + (bgr ? 0 : 2)];
+		}
+	}
+}
+
+void TextureCooker::downsample(const std::vector<unsigned char> &rgb, unsigned int width, unsigned int height, std::vector<unsigned char> &half)
+{
+	unsigned int halfWidth = std::max(1u, width / 2), halfHeight = std::max(1u, height / 2);
+	half.resize((size_t)halfWidth * halfHeight * 3);
+
+	for (unsigned int y = 0; y < halfHeight; y++)
+	{
+		unsigned int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+		for (unsigned int x = 0; x < halfWidth; x++)
+		{
+			unsigned int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+			for (int k = 0; k < 3; k++)
+			{
+				int sum = rgb[((size_t)y0 * width + x0) * 3 + k] + rgb[((size_t)y0 * width + x1) * 3 + k]
+					+ rgb[((size_t)y1 * width + x0) * 3 + k] + rgb[((size_t)y1 * width + x1) * 3 + k];
+				half[((size_t)y * halfWidth + x) * 3 + k] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+size_t TextureCooker::compressedSize(unsigned int width, unsigned int height)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+void TextureCooker::compressBC1(const unsigned char* rgb, unsigned int width, unsigned int height, unsigned char* blocks)
+{
+	unsigned int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+
+	for (unsigned int by = 0; by < blocksHigh; by++)
+	{
+		for (unsigned int bx = 0; bx < blocksWide; bx++)
+		{
+			//edge blocks repeat the last row / column
+			int pixels[16][3];
+			for (int i = 0; i < 16; i++)
+			{
+				unsigned int x = std::min(bx * 4 + i % 4, width - 1), y = std::min(by * 4 + i / 4, height - 1);
+				for (int k = 0; k < 3; k++)
+					pixels[i][k] = rgb[((size_t)y * width + x) * 3 + k];
+			}
+
+			compressBlock(pixels, blocks + ((size_t)by * blocksWide + bx) * 8);
+		}
+	}
+}
+
+void TextureCooker::decompressBC1(const unsigned char* blocks, unsigned int width, unsigned int height, unsigned char* rgb)
+{
+	unsigned int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+
+	for (unsigned int by = 0; by < blocksHigh; by++)
+	{
+		for (unsigned int bx = 0; bx < blocksWide; bx++)
+		{
+			const unsigned char* block = blocks + ((size_t)by * blocksWide + bx) * 8;
+			unsigned short c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8);
+			unsigned int selectors = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+
+			int colors[4][3];
+			palette(c0, c1, colors);
+			if (c0 <= c1)
+			{
+				//three colour mode, the fourth entry is black
+				for (int k = 0; k < 3; k++)
+				{
+					colors[2][k] = (colors[0][k] + colors[1][k]) / 2;
+					colors[3][k] = 0;
+				}
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				unsigned int x = bx * 4 + i % 4, y = by * 4 + i / 4;
+				if (x >= width || y >= height)
+					continue;
+
+				const int* color = colors[(selectors >> (i * 2)) & 3];
+				for (int k = 0; k < 3; k++)
+					rgb[((size_t)y * width + x) * 3 + k] = (unsigned char)color[k];
+			}
+		}
+	}
+}
+
+void TextureCooker::cook(const Image &image, CookedTexture &cooked, bool compress)
+{
+	cooked.format = compress ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_RGB8;
+	cooked.levels.clear();
+	cooked.data.clear();
+
+	std::vector<unsigned char> level, next;
+	toRGB(image, level);
+	unsigned int width = image.width, height = image.height;
+
+	while (true)
+	{
+		TextureLevel info;
+		info.width = width;
+		info.height = height;
+		info.offset = cooked.data.size();
+		info.size = compress ? compressedSize(width, height) : level.size();
+
+		cooked.data.resize(cooked.data.size() + (size_t)info.size);
+		if (compress)
+			compressBC1(level.data(), width, height, cooked.data.data() + info.offset);
+		else
+			memcpy(cooked.data.data() + info.offset, level.data(), level.size());
+		cooked.levels.push_back(info);
+
+		if (width == 1 && height == 1)
+			break;
+
+		downsample(level, width, height, next);
+		level.swap(next);
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+	}
+}
+
+void TextureCooker::cookDirectory(const std::string &directory)
+{
+	std::cout << "Cooking textures in " << directory << std::endl;
+	std::cout << std::left << std::setw(28) << "texture" << std::right << std::setw(12) << "size" << std::setw(8) << "mips"
+		<< std::setw(14) << "RGB8 KB" << std::setw(14) << "cooked KB" << std::setw(10) << "ratio" << std::setw(10) << "ms" << std::setw(14) << "decode MB/s" << std::endl;
+
+	size_t totalRaw = 0, totalCooked = 0;
+
+	for (const auto &entry : std::filesystem::directory_iterator(directory))
+	{
+		std::string extension = entry.path().extension().string();
+		if (extension != ".bmp" && extension != ".png")
+			continue;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		TextureData data;
+		if (!TextureLoader::readTexture(entry.path().string(), data, true))
+			continue;
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		//what the old glTexImage2D + glGenerateMipmap path kept resident
+		size_t raw = (size_t)data.getLevel(0).width * data.getLevel(0).height * 3 * 4 / 3;
+		size_t cookedBytes = data.getResidentBytes();
+		totalRaw += raw;
+		totalCooked += cookedBytes;
+
+		std::string size = std::to_string(data.getLevel(0).width) + "x" + std::to_string(data.getLevel(0).height);
+		std::cout << std::left << std::setw(28) << entry.path().filename().string() << std::right << std::setw(12) << size
+			<< std::setw(8) << data.getLevelCount() << std::fixed << std::setprecision(1)
+			<< std::setw(14) << raw / 1024.0 << std::setw(14) << cookedBytes / 1024.0
+			<< std::setw(10) << (double)raw / cookedBytes << std::setw(10) << ms
+			<< std::setw(14) << data.decodedBytes / (1024.0 * 1024.0) / data.decodeSeconds << std::endl;
+	}
+
+	std::cout << std::left << std::setw(48) << "total" << std::right << std::fixed << std::setprecision(1)
+		<< std::setw(14) << totalRaw / 1024.0 << std::setw(14) << totalCooked / 1024.0
+		<< std::setw(10) << (totalCooked ? (double)totalRaw / totalCooked : 0.0) << std::endl;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "texture.h"
+
+//One mip level inside a cooked texture's data
+struct TextureLevel
+{
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;
+	uint64_t size;
+};
+
+//A texture ready for upload: every mip level, already in its GPU format
+struct CookedTexture
+{
+	//GL_COMPRESSED_RGB_S3TC_DXT1_EXT, or GL_RGB8 for the uncompressed fallback
+	uint32_t format = 0;
+	std::vector<TextureLevel> levels;
+	std::vector<unsigned char> data;
+};
+
+//Turns decoded images into CookedTextures: a box filtered mip chain down to 1x1,
+//each level block compressed to BC1 (S3TC DXT1, 6:1 against RGB8).
+//Runs without GL, so it works both offline (--cook-textures) and on loader threads.
+class TextureCooker
+{
+	public:
+		static void cook(const Image &image, CookedTexture &cooked, bool compress = true);
+
+		//RGB8 copy of an image, whatever its channel order
+		static void toRGB(const Image &image, std::vector<unsigned char> &rgb);
+		//next mip level of a tightly packed RGB8 image, odd sizes round down
+		static void downsample(const std::vector<unsigned char> &rgb, unsigned int width, unsigned int height, std::vector<unsigned char> &half);
+
+		static void compressBC1(const unsigned char* rgb, unsigned int width, unsigned int height, unsigned char* blocks);
+		//for drivers without S3TC support
+		static void decompressBC1(const unsigned char* blocks, unsigned int width, unsigned int height, unsigned char* rgb);
+		static size_t compressedSize(unsigned int width, unsigned int height);
+
+		//Cooks every .bmp and .png in a directory into .mawtex caches and prints the size, time and decode speed of each
+		static void cookDirectory(const std::string &directory);
+};
@@ -0,0 +1,169 @@
+#include "textureLoader.h"
+#include "..\Assets\vfs.h"
+#include "contentHash.h"
+#include "textureStaging.h"
+#include <chrono>
+#include <cstdio>
+
+uint32_t TextureData::getFormat() const
+{
+	return cached ? cache.getFormat() : cooked.format;
+}
+
+unsigned int TextureData::getLevelCount() const
+{
+	return cached ? cache.getLevelCount() : (unsigned int)cooked.levels.size();
+}
+
+const TextureLevel &TextureData::getLevel(unsigned int level) const
+{
+	return cached ? cache.getLevels()[level] : cooked.levels[level];
+}
+
+const unsigned char* TextureData::getLevelData(unsigned int level) const
+{
+	const unsigned char* base = cached ? cache.getData() : cooked.data.data();
+	return base + getLevel(level).offset;
+}
+
+size_t TextureData::getResidentBytes() const
+{
+	size_t bytes = 0;
+	for (unsigned int i = 0; i < getLevelCount(); i++)
+		bytes += (size_t)getLevel(i).size;
+	return bytes;
+}
+
+bool TextureLoader::readTexture(const std::string &path, TextureData &data, bool recook)
+{
+	VfsFile file(path);
+	if (!file.isOpen())
+	{
+		printf("%s could not be opened.\n", path.c_str());
+		return false;
+	}
+
+	//A cooked .mawtex next to the image is used as long as it was built from the same bytes
+	uint64_t sourceHash = hashContent(file.data(), file.size());
+	std::string cachePath = TextureCache::pathFor(path);
+
+	data.cached = !recook && data.cache.open(cachePath, sourceHash);
+	if (data.cached)
+		return true;
+
+	printf("Reading image %s\n", path.c_str());
+
+	auto decodeStart = std::chrono::high_resolution_clock::now();
+	Image image;
+	if (!decodeImage((const unsigned char*)file.data(), file.size(), image, path.c_str()))
+		return false;
+
+	data.decodeSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - decodeStart).count();
+	data.decodedBytes = file.size();
+	data.decodedPixels = (size_t)image.width * image.height;
+
+	TextureCooker::cook(image, data.cooked);
+
+	if (!TextureCache::write(cachePath, sourceHash, data.cooked))
+		printf("Could not write texture cache %s\n", cachePath.c_str());
+
+	return true;
+}
+
+void TextureLoader::upload(GLuint textureID, const TextureData &data)
+{
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	uint32_t format = data.getFormat();
+	bool compressed = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	bool decode = compressed && !GLEW_EXT_texture_compression_s3tc;
+
+	//RGB8 levels are tightly packed
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	//level bytes go from the mapped cache into the shared staging ring, the uploads read them from there
+	TextureStaging &staging = TextureStaging::shared();
+	staging.begin(uploadedBytes(data), data.getLevelCount());
+
+	std::vector<unsigned char> decoded;
+	for (unsigned int i = 0; i < data.getLevelCount(); i++)
+	{
+		const TextureLevel &level = data.getLevel(i);
+
+		if (decode)
+		{
+			decoded.resize((size_t)level.width * level.height * 3);
+			TextureCooker::decompressBC1(data.getLevelData(i), level.width, level.height, decoded.data());
+			const void* pixels = staging.stage(decoded.data(), decoded.size());
+			glTexImage2D(GL_TEXTURE_2D, i, GL_RGB8, level.width, level.height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+		}
+		else if (compressed)
+		{
+			const void* pixels = staging.stage(data.getLevelData(i), (size_t)level.size);
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, format, level.width, level.height, 0, (GLsizei)level.size, pixels);
+		}
+		else
+		{
+			const void* pixels = staging.stage(data.getLevelData(i), (size_t)level.size);
+			glTexImage2D(GL_TEXTURE_2D, i, GL_RGB8, level.width, level.height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+		}
+	}
+
+	staging.end();
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, data.getLevelCount() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+}
+
+void TextureLoader::upload(TextureResource &resource, const TextureData &data)
+{
+	upload(resource.id, data);
+
+	bool decoded = data.getFormat() == GL_COMPRESSED_RGB_S3TC_DXT1_EXT && !GLEW_EXT_texture_compression_s3tc;
+	resource.internalFormat = decoded ? GL_RGB8 : data.getFormat();
+	resource.width = data.getLevel(0).width;
+	resource.height = data.getLevel(0).height;
+	resource.levelCount = data.getLevelCount();
+	resource.residentBytes = uploadedBytes(data);
+}
+
+void TextureLoader::uploadFallback(TextureResource &resource, const std::string &path)
+{
+	printf("Texture %s failed to load, using a placeholder\n", path.c_str());
+
+	static const unsigned char magenta[3] = { 255, 0, 255 };
+
+	glBindTexture(GL_TEXTURE_2D, resource.id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, magenta);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+	resource.internalFormat = GL_RGB8;
+	resource.width = 1;
+	resource.height = 1;
+	resource.levelCount = 1;
+	resource.residentBytes = sizeof(magenta);
+}
+
+size_t TextureLoader::uploadedBytes(const TextureData &data)
+{
+	if (data.getFormat() == GL_COMPRESSED_RGB_S3TC_DXT1_EXT && !GLEW_EXT_texture_compression_s3tc)
+	{
+		size_t bytes = 0;
+		for (unsigned int i = 0; i < data.getLevelCount(); i++)
+			bytes += (size_t)data.getLevel(i).width * data.getLevel(i).height * 3;
+		return bytes;
+	}
+
+	return data.getResidentBytes();
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include "texture.h"
+#include "textureCooker.h"
+#include "textureCache.h"
+
+//CPU side result of reading a texture, ready to be uploaded on the GL thread.
+//When a valid cache was found the levels stay in the mapped .mawtex file.
+struct TextureData
+{
+	CookedTexture cooked;
+	TextureCache cache;
+	bool cached = false;
+
+	//set when the source image had to be decoded (no valid cache)
+	double decodeSeconds = 0.0;
+	size_t decodedBytes = 0;
+	size_t decodedPixels = 0;
+
+	uint32_t getFormat() const;
+	unsigned int getLevelCount() const;
+	const TextureLevel &getLevel(unsigned int level) const;
+	const unsigned char* getLevelData(unsigned int level) const;
+	//bytes the uploaded texture occupies on the GPU, every level included
+	size_t getResidentBytes() const;
+};
+
+class TextureLoader
+{
+	public:
+		//Reads (or cooks) the texture without touching GL, safe to call from worker threads.
+		//recook ignores an existing cache, used by the offline cooker.
+		static bool readTexture(const std::string &path, TextureData &data, bool recook = false);
+
+		//Uploads every cooked level with glCompressedTexImage2D through the TextureStaging ring,
+		//the mip chain is never generated on the GPU. Drivers without S3TC get the levels decoded to RGB8 instead.
+		static void upload(GLuint textureID, const TextureData &data);
+		//same, and records the size, format and resident bytes on the resource
+		static void upload(TextureResource &resource, const TextureData &data);
+		static size_t uploadedBytes(const TextureData &data);
+		//uploads a 1x1 magenta placeholder for a texture whose image could not be read,
+		//so draws using it show the problem instead of sampling an empty texture
+		static void uploadFallback(TextureResource &resource, const std::string &path);
+};
@@ -0,0 +1,173 @@
+#include "textureStaging.h"
+#include <cstring>
+#include <iostream>
+
+//keeps level data aligned for the copy engines (and the 8 byte BC1 blocks)
+static const size_t STAGING_ALIGNMENT = 256;
+
+static size_t alignUp(size_t value)
+{
+	return (value + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+}
+
+TextureStaging &TextureStaging::shared()
+{
+	static TextureStaging staging;
+	return staging;
+}
+
+TextureStaging::TextureStaging()
+{
+	buffer = 0;
+	mapped = nullptr;
+	created = false;
+	active = false;
+	head = 0;
+	sliceStart = 0;
+	stagedBytes = 0;
+	waits = 0;
+}
+
+TextureStaging::~TextureStaging()
+{
+	//the context is usually gone by the time statics are destroyed, see release()
+}
+
+bool TextureStaging::create()
+{
+	if (created)
+		return mapped != nullptr;
+	created = true;
+
+	if (!GLEW_ARB_buffer_storage)
+	{
+		std::cout << "Texture staging: no ARB_buffer_storage, uploading from client memory" << std::endl;
+		return false;
+	}
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, RING_SIZE, nullptr, flags);
+	mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, RING_SIZE, flags);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (mapped == nullptr)
+	{
+		std::cout << "Texture staging: could not map the staging buffer, uploading from client memory" << std::endl;
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+		return false;
+	}
+
+	return true;
+}
+
+void TextureStaging::waitFor(size_t start, size_t end)
+{
+	//fences signal in submission order, so waiting on the newest slice overlapping
+	//[start, end) retires it and everything queued before it
+	size_t count = 0;
+	for (size_t i = 0; i < inFlight.size(); i++)
+	{
+		if (inFlight[i].start < end && inFlight[i].end > start)
+			count = i + 1;
+	}
+	if (count == 0)
+		return;
+
+	GLsync newest = inFlight[count - 1].fence;
+	if (glClientWaitSync(newest, 0, 0) == GL_TIMEOUT_EXPIRED)
+	{
+		waits++;
+		glClientWaitSync(newest, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		glDeleteSync(inFlight.front().fence);
+		inFlight.pop_front();
+	}
+}
+
+bool TextureStaging::begin(size_t totalBytes, unsigned int levelCount)
+{
+	active = false;
+	if (!create())
+		return false;
+
+	//every level may be padded up to the alignment
+	size_t needed = totalBytes + (size_t)levelCount * STAGING_ALIGNMENT;
+	if (needed > RING_SIZE)
+		return false;
+
+	if (head + needed > RING_SIZE)
+		head = 0;
+
+	waitFor(head, head + needed);
+
+	sliceStart = head;
+	active = true;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	return true;
+}
+
+const void* TextureStaging::stage(const void* data, size_t size)
+{
+	if (!active)
+		return data;
+
+	size_t offset = head;
+	memcpy(mapped + offset, data, size);
+	head = alignUp(offset + size);
+	stagedBytes += size;
+
+	//with a buffer bound the pixels "pointer" is an offset into it
+	return (const void*)offset;
+}
+
+void TextureStaging::end()
+{
+	if (!active)
+		return;
+
+	Slice slice;
+	slice.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slice.start = sliceStart;
+	slice.end = head;
+	inFlight.push_back(slice);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	active = false;
+}
+
+void TextureStaging::release()
+{
+	for (const Slice &slice : inFlight)
+		glDeleteSync(slice.fence);
+	inFlight.clear();
+
+	if (buffer != 0)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+	}
+
+	buffer = 0;
+	mapped = nullptr;
+	created = false;
+	head = 0;
+}
+
+size_t TextureStaging::getStagedBytes() const
+{
+	return stagedBytes;
+}
+
+unsigned int TextureStaging::getWaits() const
+{
+	return waits;
+}
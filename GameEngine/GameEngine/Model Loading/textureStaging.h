@@ -0,0 +1,60 @@
+#pragma once
+#include <glew.h>
+#include <glfw3.h>
+#include <deque>
+
+//Ring of pixel unpack buffer memory shared by every texture upload.
+//The buffer is created once with glBufferStorage and stays mapped (persistent + coherent),
+//so level data is memcpy'd straight from the mapped source file into it and the
+//glTexImage calls only queue a DMA from the buffer; they return without touching the pixels.
+//Each texture's slice is fenced and only rewritten once the GPU has consumed it.
+//Without GL 4.4 / ARB_buffer_storage every call passes the client pointer through instead.
+//GL thread only.
+class TextureStaging
+{
+	public:
+		static const size_t RING_SIZE = 16 * 1024 * 1024;
+
+		static TextureStaging &shared();
+
+		//reserves room for a whole texture and binds the ring as GL_PIXEL_UNPACK_BUFFER,
+		//false (and nothing bound) when the ring is unavailable or the texture does not fit
+		bool begin(size_t totalBytes, unsigned int levelCount);
+		//copies one level into the reserved slice, returns what to pass as the pixels pointer
+		const void* stage(const void* data, size_t size);
+		//fences the slice and unbinds the ring
+		void end();
+
+		//deletes the buffer, call while the context is still current
+		void release();
+
+		size_t getStagedBytes() const;
+		unsigned int getWaits() const;
+
+	private:
+		TextureStaging();
+		~TextureStaging();
+
+		TextureStaging(const TextureStaging&) = delete;
+		TextureStaging& operator=(const TextureStaging&) = delete;
+
+		bool create();
+		void waitFor(size_t start, size_t end);
+
+		struct Slice
+		{
+			GLsync fence;
+			size_t start, end;
+		};
+
+		GLuint buffer;
+		unsigned char* mapped;
+		bool created;
+		bool active;
+		size_t head;
+		size_t sliceStart;
+		std::deque<Slice> inFlight;
+
+		size_t stagedBytes;
+		unsigned int waits;
+};
@@ -7,6 +7,8 @@ in vec3 fragPos;
 out vec4 fragColor;
 
 uniform sampler2D texture1;
+uniform sampler2DArray textureArray;
+uniform int textureLayer;
 uniform vec3 lightColor;
 uniform vec3 lightPos;
 uniform vec3 viewPos;
@@ -36,7 +38,10 @@ void main()
     
     vec4 texColor;
     if (useTexture) {
-        texColor = texture(texture1, textureCoord);
+        if (textureLayer >= 0)
+            texColor = texture(textureArray, vec3(textureCoord, textureLayer));
+        else
+            texColor = texture(texture1, textureCoord);
     } else {
         texColor = vec4(overrideColor, 1.0);
     }
@@ -0,0 +1,133 @@
+#include "programCache.h"
+#include "..\Model Loading\contentHash.h"
+#include "..\Model Loading\mappedFile.h"
+#include <atomic>
+#include <fstream>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+static const char PROGRAM_CACHE_MAGIC[4] = { 'M', 'A', 'W', 'S' };
+static const uint64_t PROGRAM_CACHE_ALIGNMENT = 64;
+
+bool ProgramCache::isSupported()
+{
+	if (!GLEW_ARB_get_program_binary)
+		return false;
+
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+std::string ProgramCache::pathFor(const std::string &vertexPath, const std::string &fragmentPath)
+{
+	//"Shaders/vertex_shader.glsl" + "Shaders/fragment_shader.glsl" -> "Shaders/vertex_shader+fragment_shader.mawprog"
+	auto stem = [](const std::string &path) {
+		size_t slash = path.find_last_of("/\\");
+		size_t begin = slash == std::string::npos ? 0 : slash + 1;
+		size_t dot = path.find_last_of('.');
+		if (dot == std::string::npos || dot < begin)
+			dot = path.size();
+		return path.substr(begin, dot - begin);
+	};
+
+	size_t slash = vertexPath.find_last_of("/\\");
+	std::string directory = slash == std::string::npos ? "" : vertexPath.substr(0, slash + 1);
+
+	return directory + stem(vertexPath) + "+" + stem(fragmentPath) + ".mawprog";
+}
+
+uint64_t ProgramCache::keyFor(const std::string &vertexCode, const std::string &fragmentCode)
+{
+	uint64_t key = hashContent(vertexCode.data(), vertexCode.size());
+	key = hashContent(fragmentCode.data(), fragmentCode.size(), key);
+
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+	{
+		const char* value = (const char*)glGetString(name);
+		if (value)
+			key = hashContent(value, strlen(value), key);
+	}
+
+	return key;
+}
+
+bool ProgramCache::load(const std::string &path, uint64_t key, GLuint program)
+{
+	if (!isSupported())
+		return false;
+
+	//driver specific, so it is never packed: always the local file
+	MappedFile file(path);
+	if (!file.isOpen() || file.size() < sizeof(ProgramCacheHeader))
+		return false;
+
+	const ProgramCacheHeader* h = (const ProgramCacheHeader*)file.data();
+	if (memcmp(h->magic, PROGRAM_CACHE_MAGIC, 4) != 0 || h->version != VERSION || h->key != key)
+		return false;
+
+	if (h->dataOffset + h->binarySize > file.size())
+		return false;
+
+	glProgramBinary(program, h->binaryFormat, file.data() + h->dataOffset, h->binarySize);
+
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	return success == GL_TRUE;
+}
+
+bool ProgramCache::write(const std::string &path, uint64_t key, GLuint program)
+{
+	if (!isSupported())
+		return false;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return false;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &format, binary.data());
+	if (written <= 0)
+		return false;
+
+	ProgramCacheHeader h;
+	memcpy(h.magic, PROGRAM_CACHE_MAGIC, 4);
+	h.version = VERSION;
+	h.key = key;
+	h.binaryFormat = format;
+	h.binarySize = (uint32_t)written;
+	h.dataOffset = PROGRAM_CACHE_ALIGNMENT;
+
+	//same temporary name + rename dance as the mesh and texture caches
+	static std::atomic<unsigned int> tempCounter(0);
+	std::string tempPath = path + ".tmp" + std::to_string(tempCounter++);
+	std::ofstream out(tempPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.good())
+		return false;
+
+	static const char padding[PROGRAM_CACHE_ALIGNMENT] = {};
+
+	out.write((const char*)&h, sizeof(h));
+	out.write(padding, h.dataOffset - sizeof(h));
+	out.write(binary.data(), written);
+	out.close();
+
+	if (!out.good())
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	std::remove(path.c_str());
+	if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
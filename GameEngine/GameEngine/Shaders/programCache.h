@@ -0,0 +1,34 @@
+#pragma once
+#include <glew.h>
+#include <cstdint>
+#include <string>
+
+//Linked program binary (.mawprog) written next to the vertex shader the first time a pair is linked.
+//Layout: ProgramCacheHeader, then the driver's binary starting on a 64 byte boundary.
+//The key covers both sources and the GL vendor, renderer and version strings, so an edited
+//shader or a driver update falls back to compiling from source.
+struct ProgramCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t binaryFormat;
+	uint32_t binarySize;
+	uint64_t dataOffset;
+};
+
+class ProgramCache
+{
+	public:
+		static const uint32_t VERSION = 1;
+
+		//ARB_get_program_binary with at least one binary format
+		static bool isSupported();
+
+		static std::string pathFor(const std::string &vertexPath, const std::string &fragmentPath);
+		static uint64_t keyFor(const std::string &vertexCode, const std::string &fragmentCode);
+
+		//false if the file is missing, stale or the driver rejects the binary; the program stays unlinked then
+		static bool load(const std::string &path, uint64_t key, GLuint program);
+		static bool write(const std::string &path, uint64_t key, GLuint program);
+};
@@ -1,114 +1,274 @@
 #include "shader.h"
+#include "programCache.h"
+#include "..\Graphics\glState.h"
+#include "..\Assets\vfs.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <vector>
 
 using namespace std;
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+static GLuint compileStage(GLenum type, const std::string &code)
 {
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::ifstream vertexShaderFile;
-	std::ifstream fragmentShaderFile;
+	const char* source = code.c_str();
+	GLuint stage = glCreateShader(type);
+	glShaderSource(stage, 1, &source, NULL);
+	glCompileShader(stage);
 
-	try
+	int success;
+	glGetShaderiv(stage, GL_COMPILE_STATUS, &success);
+	if (!success)
 	{
-        vertexShaderFile.open(vertexPath);
-        fragmentShaderFile.open(fragmentPath);
-        if (vertexShaderFile.is_open() && fragmentShaderFile.is_open()) {
-            std::stringstream vShaderStream, fShaderStream;
-            vShaderStream << vertexShaderFile.rdbuf();
-            fShaderStream << fragmentShaderFile.rdbuf();
-            vertexShaderFile.close();
-            fragmentShaderFile.close();
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        } else {
-            std::cout << "Warning: shader files not found: " << vertexPath << " or " << fragmentPath << ". Using fallback shaders." << std::endl;
-        }
+		int InfoLogLength;
+		glGetShaderiv(stage, GL_INFO_LOG_LENGTH, &InfoLogLength);
+		std::vector<char> message(InfoLogLength + 1);
+		glGetShaderInfoLog(stage, InfoLogLength, NULL, &message[0]);
+		std::cout << "Error compiling " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader! " << &message[0] << std::endl;
+		glDeleteShader(stage);
+		return 0;
 	}
-	catch (std::ifstream::failure e)
+
+	return stage;
+}
+
+// every name passed to Shader::uniform, indexed by handle
+static std::vector<std::string>& uniformNames()
+{
+	static std::vector<std::string> names;
+	return names;
+}
+
+// compiles both stages and links them into program, the stages are detached again afterwards
+static bool linkProgram(GLuint program, const std::string &vertexCode, const std::string &fragmentCode)
+{
+	GLuint vertex = compileStage(GL_VERTEX_SHADER, vertexCode);
+	GLuint fragment = compileStage(GL_FRAGMENT_SHADER, fragmentCode);
+	if (vertex == 0 || fragment == 0)
 	{
-        std::cout << "Error reading shader files, using fallback shaders." << std::endl;
+		glDeleteShader(vertex);
+		glDeleteShader(fragment);
+		return false;
+	}
+
+	// a relinked program drops whatever stages it was built from before
+	GLuint attached[8];
+	GLsizei attachedCount = 0;
+	glGetAttachedShaders(program, 8, &attachedCount, attached);
+	for (GLsizei i = 0; i < attachedCount; i++)
+		glDetachShader(program, attached[i]);
+
+	if (GLEW_ARB_get_program_binary)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	glAttachShader(program, vertex);
+	glAttachShader(program, fragment);
+	glLinkProgram(program);
+	glDetachShader(program, vertex);
+	glDetachShader(program, fragment);
+
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+		std::cout << "Error linking shader!" << std::endl;
+
+	return success != 0;
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath)
+{
+	std::string vertexCode;
+	std::string fragmentCode;
+
+	// read through the Vfs, so the sources come from the asset pack when one is mounted
+	VfsFile vertexShaderFile(vertexPath);
+	VfsFile fragmentShaderFile(fragmentPath);
+	if (vertexShaderFile.isOpen() && fragmentShaderFile.isOpen()) {
+		vertexCode.assign(vertexShaderFile.data(), vertexShaderFile.size());
+		fragmentCode.assign(fragmentShaderFile.data(), fragmentShaderFile.size());
+	} else {
+		std::cout << "Warning: shader files not found: " << vertexPath << " or " << fragmentPath << ". Using fallback shaders." << std::endl;
 	}
-	const char* vShaderCode = vertexCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
 
     // If files were empty or not loaded, provide minimal fallback shaders
     std::string fallbackVertex = "#version 330 core\nlayout(location = 0) in vec3 pos; uniform mat4 MVP; void main(){ gl_Position = MVP * vec4(pos,1.0); }";
     std::string fallbackFragment = "#version 330 core\nout vec4 fragColor; void main(){ fragColor = vec4(1.0,0.0,1.0,1.0); }";
-    if (vertexCode.empty()) vShaderCode = fallbackVertex.c_str();
-    if (fragmentCode.empty()) fShaderCode = fallbackFragment.c_str();
+    if (vertexCode.empty()) vertexCode = fallbackVertex;
+    if (fragmentCode.empty()) fragmentCode = fallbackFragment;
 
-	//compile shaders
-	unsigned int vertex, fragment;
-	int success;
+	// a binary linked by an earlier run skips compiling and linking entirely
+	chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+	cachePath = ProgramCache::pathFor(vertexPath, fragmentPath);
+	uint64_t key = ProgramCache::keyFor(vertexCode, fragmentCode);
 
-	// vertex Shader
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &vShaderCode, NULL);
-	glCompileShader(vertex);
+	id = glCreateProgram();
+	bool cached = ProgramCache::load(cachePath, key, id);
+	bool linked = cached || linkProgram(id, vertexCode, fragmentCode);
 
-	// compile errors 
-	glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		std::cout << "Error compiling vertex shader! " << std::endl;
-	}
+	double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+	printf("Shader %s + %s: %s in %.1f ms\n", vertexPath, fragmentPath, cached ? "program binary loaded" : "compiled and linked", ms);
 
-	// fragment Shader
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &fShaderCode, NULL);
-	glCompileShader(fragment);
+	if (!cached && linked)
+		ProgramCache::write(cachePath, key, id);
 
-	// compile errors
-	glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-	if (!success)
+	uniformUploads = 0;
+	skippedUniformUploads = 0;
+	reflect();
+}
+
+bool Shader::reload(const std::string &vertexCode, const std::string &fragmentCode)
+{
+	// link a scratch program first, a failed link on the live one would leave it unusable
+	GLuint scratch = glCreateProgram();
+	bool linked = linkProgram(scratch, vertexCode, fragmentCode);
+	glDeleteProgram(scratch);
+	if (!linked)
+		return false;
+
+	// then relink the live program in place, its id stays valid for every copy
+	if (!linkProgram(id, vertexCode, fragmentCode))
+		return false;
+
+	// the old binary is stale now; store the new one so the next run starts from it
+	ProgramCache::write(cachePath, ProgramCache::keyFor(vertexCode, fragmentCode), id);
+
+	// locations can move and every uniform is back to its default after a relink
+	reflect();
+	return true;
+}
+
+Shader::Uniform Shader::uniform(const std::string &name)
+{
+	static std::unordered_map<std::string, Uniform> handles;
+
+	auto it = handles.find(name);
+	if (it != handles.end())
+		return it->second;
+
+	Uniform handle = (Uniform)uniformNames().size();
+	uniformNames().push_back(name);
+	handles[name] = handle;
+	return handle;
+}
+
+void Shader::reflect()
+{
+	activeUniforms.clear();
+	uniforms.clear();
+
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+	std::vector<char> name(std::max(maxLength, 1) + 1);
+	for (GLint i = 0; i < count; i++)
 	{
-		std::cout << "Error compiling fragment shader! " << std::endl;
-	}
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(id, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
 
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
+		// arrays are reported as "name[0]", they are set through their base name
+		std::string uniformName(name.data(), length);
+		size_t bracket = uniformName.find('[');
+		if (bracket != std::string::npos)
+			uniformName.resize(bracket);
 
-	// Check Vertex Shader
-	glGetShaderiv(vertex, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(vertex, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if (InfoLogLength > 0) {
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength + 1);
-		glGetShaderInfoLog(vertex, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-		printf("%s\n", &VertexShaderErrorMessage[0]);
+		activeUniforms[uniformName] = glGetUniformLocation(id, name.data());
 	}
+}
 
-	// Check Fragment Shader
-	glGetShaderiv(fragment, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(fragment, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if (InfoLogLength > 0) {
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength + 1);
-		glGetShaderInfoLog(fragment, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-		printf("%s\n", &FragmentShaderErrorMessage[0]);
+Shader::UniformState& Shader::state(Uniform uniform)
+{
+	if (uniform >= uniforms.size())
+		uniforms.resize(uniform + 1, UniformState{ -1, false, false, {} });
+
+	UniformState &state = uniforms[uniform];
+	if (!state.resolved)
+	{
+		auto it = activeUniforms.find(uniformNames()[uniform]);
+		state.location = it != activeUniforms.end() ? it->second : -1;
+		state.resolved = true;
 	}
 
-	// shader Program
-	id = glCreateProgram();
-	glAttachShader(id, vertex);
-	glAttachShader(id, fragment);
-	glLinkProgram(id);
+	return state;
+}
 
-	// linking errors
-	glGetProgramiv(id, GL_LINK_STATUS, &success);
-	if (!success)
+bool Shader::changed(UniformState &state, const void* value, size_t size)
+{
+	if (state.location < 0)
+		return false;
+
+	if (state.known && memcmp(state.value, value, size) == 0)
 	{
-		std::cout << "Error linking shader!" << std::endl;
+		skippedUniformUploads++;
+		return false;
 	}
- 
-	glDeleteShader(vertex);
-	glDeleteShader(fragment);
+
+	memcpy(state.value, value, size);
+	state.known = true;
+	uniformUploads++;
+	return true;
+}
+
+void Shader::set(Uniform uniform, int value)
+{
+	UniformState &s = state(uniform);
+	if (changed(s, &value, sizeof(value)))
+		glUniform1i(s.location, value);
+}
+
+void Shader::set(Uniform uniform, float value)
+{
+	UniformState &s = state(uniform);
+	if (changed(s, &value, sizeof(value)))
+		glUniform1f(s.location, value);
+}
+
+void Shader::set(Uniform uniform, const glm::vec3 &value)
+{
+	UniformState &s = state(uniform);
+	if (changed(s, &value[0], sizeof(value)))
+		glUniform3fv(s.location, 1, &value[0]);
+}
+
+void Shader::set(Uniform uniform, const glm::mat3 &value)
+{
+	UniformState &s = state(uniform);
+	if (changed(s, &value[0][0], sizeof(value)))
+		glUniformMatrix3fv(s.location, 1, GL_FALSE, &value[0][0]);
+}
+
+void Shader::set(Uniform uniform, const glm::mat4 &value)
+{
+	UniformState &s = state(uniform);
+	if (changed(s, &value[0][0], sizeof(value)))
+		glUniformMatrix4fv(s.location, 1, GL_FALSE, &value[0][0]);
+}
+
+unsigned int Shader::getUniformUploads() const
+{
+	return uniformUploads;
+}
+
+unsigned int Shader::getSkippedUniformUploads() const
+{
+	return skippedUniformUploads;
+}
+
+void Shader::resetUniformStats()
+{
+	uniformUploads = 0;
+	skippedUniformUploads = 0;
 }
 
 void Shader::use()
 {
-	glUseProgram(id);
+	GLState::shared().useProgram(id);
 }
 
 int Shader::getId()
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <glew.h>
+#include <glm.hpp>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -11,10 +14,59 @@ class Shader
 public:
 	Shader(const char* vertexPath, const char* fragmentPath);
 	~Shader();
+
+	//the program, its uniform locations and the last values sent belong to one object,
+	//so a Shader is passed by reference and never copied
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
+
 	void use();
 	int getId();
 
+	//Rebuilds the program from new sources under the same id and reads its uniforms again.
+	//Compile or link errors leave the current program untouched and return false.
+	bool reload(const std::string &vertexCode, const std::string &fragmentCode);
+
+	//Handle naming a uniform, shared by every Shader, so it can be resolved once up front
+	//(a static, a member) instead of per draw. Unknown or inactive uniforms are ignored by set().
+	typedef unsigned int Uniform;
+	static Uniform uniform(const std::string &name);
+
+	//Typed setters for the program currently in use. The last value sent is remembered,
+	//so setting the same value again issues no GL call.
+	void set(Uniform uniform, int value);
+	void set(Uniform uniform, float value);
+	void set(Uniform uniform, const glm::vec3 &value);
+	void set(Uniform uniform, const glm::mat3 &value);
+	void set(Uniform uniform, const glm::mat4 &value);
+
+	//uniform uploads issued and skipped as unchanged since the last resetUniformStats()
+	unsigned int getUniformUploads() const;
+	unsigned int getSkippedUniformUploads() const;
+	void resetUniformStats();
+
 private:
+	struct UniformState
+	{
+		GLint location;
+		bool resolved;
+		bool known;
+		unsigned char value[sizeof(glm::mat4)];
+	};
+
+	// reads every active uniform after a link; the remembered values are dropped with the old program
+	void reflect();
+	UniformState& state(Uniform uniform);
+	bool changed(UniformState &state, const void* value, size_t size);
+
 	unsigned int id;
+	// program binary written after every successful link, see ProgramCache
+	std::string cachePath;
+
+	std::unordered_map<std::string, GLint> activeUniforms;
+	// indexed by Uniform handle, filled in as handles are first used with this program
+	std::vector<UniformState> uniforms;
+	unsigned int uniformUploads;
+	unsigned int skippedUniformUploads;
 };
 
@@ -3,6 +3,9 @@
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec3 normals;
 layout (location = 2) in vec2 texCoord;
+//per-instance model and normal matrices, read instead of the uniforms by instanced draws
+layout (location = 3) in mat4 instanceModel;
+layout (location = 7) in mat3 instanceNormalMatrix;
 
 out vec2 textureCoord;
 out vec3 norm;
@@ -10,11 +13,23 @@ out vec3 fragPos;
 
 uniform mat4 MVP;
 uniform mat4 model;
+//inverse transpose of model's upper 3x3, computed once per object on the CPU
+uniform mat3 normalMatrix;
+uniform mat4 viewProjection;
+uniform bool instanced;
+
+//packed meshes store positions normalized over their bounds (identity for float meshes)
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
 void main()
 {
+	vec3 position = positionOffset + pos * positionScale;
+
+	mat4 modelMatrix = instanced ? instanceModel : model;
+
 	textureCoord = texCoord;
-	fragPos = vec3(model * vec4(pos, 1.0f));
-	norm = mat3(transpose(inverse(model)))*normals;
-	gl_Position = MVP * vec4(pos, 1.0f);
+	fragPos = vec3(modelMatrix * vec4(position, 1.0f));
+	norm = (instanced ? instanceNormalMatrix : normalMatrix) * normals;
+	gl_Position = instanced ? viewProjection * vec4(fragPos, 1.0f) : MVP * vec4(position, 1.0f);
 }
\ No newline at end of file
@@ -12,9 +12,13 @@ uniform mat4 model;
 uniform mat4 MVP;
 uniform float time;
 
+//packed meshes store positions normalized over their bounds (identity for float meshes)
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
 void main()
 {
-    vec3 pos = aPos;
+    vec3 pos = positionOffset + aPos * positionScale;
 
     // Gentle, stable wave displacement in OBJECT space.
     // Keeping amplitudes small prevents extreme derivatives / sparkling.
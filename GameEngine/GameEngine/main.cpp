@@ -1,14 +1,24 @@
 #include "Graphics\window.h"
+#include "Graphics\glState.h"
+#include "Graphics\renderQueue.h"
+#include "Graphics\frustum.h"
 #include "Camera\camera.h"
 #include "Shaders\shader.h"
 #include "Model Loading\mesh.h"
 #include "Model Loading\texture.h"
 #include "Model Loading\meshLoaderObj.h"
+#include "Model Loading\textureCooker.h"
+#include "Model Loading\textureStaging.h"
+#include "Assets\levelStreamer.h"
+#include "Assets\hotReloader.h"
+#include "Assets\assetPack.h"
+#include "Assets\vfs.h"
 #include <iostream>
 #include <vector>
 #include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <thread>
 #include <glew.h>
 #include <glfw3.h>
 #include <glm.hpp>
@@ -125,8 +135,31 @@ void resolveOverlap(GameObject& a, GameObject& b)
 	}
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	// --- TOOLS ---
+	if (argc > 1 && strcmp(argv[1], "--bench-obj") == 0) {
+		MeshLoaderObj::benchmark("Resources/Models");
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "--mesh-report") == 0) {
+		MeshLoaderObj::report("Resources/Models");
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "--cook-textures") == 0) {
+		TextureCooker::cookDirectory("Resources/Textures");
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "--pack") == 0) {
+		// cook first so the pack carries the .mawmesh / .mawtex files next to their sources
+		MeshLoaderObj::cookDirectory("Resources/Models");
+		TextureCooker::cookDirectory("Resources/Textures");
+		return AssetPack::write("assets.mawpak", { "Resources", "Shaders" }) ? 0 : 1;
+	}
+
+	// Every asset read goes through the Vfs; without a pack the loose files are used
+	Vfs::mount("assets.mawpak");
+
 	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
 	// --- SETUP IMGUI ---
@@ -140,61 +173,65 @@ int main()
 	Shader shader("Shaders/vertex_shader.glsl", "Shaders/fragment_shader.glsl");
 	Shader waterShader("Shaders/water_vertex_shader.glsl", "Shaders/water_fragment_shader.glsl");
 
-	MeshLoaderObj loader;
-
-	// --- Load Textures ---
-	Texture t_wood; t_wood.id = loadBMP("Resources/Textures/wood.bmp"); t_wood.type = "texture_diffuse";
-	Texture t_rock; t_rock.id = loadBMP("Resources/Textures/rock1.bmp"); t_rock.type = "texture_diffuse";
-	Texture t_orange; t_orange.id = loadBMP("Resources/Textures/orange.bmp"); t_orange.type = "texture_diffuse";
-
-	Texture t_dirty_water; t_dirty_water.id = loadBMP("Resources/Textures/rock1.bmp"); t_dirty_water.type = "texture_diffuse";
-
-	Texture t_rat; t_rat.id = loadBMP("Resources/Textures/mouse.bmp"); t_rat.type = "texture_diffuse";
-	Texture t_cat; t_cat.id = loadBMP("Resources/Textures/cat_color.bmp"); t_cat.type = "texture_diffuse";
-	Texture t_green_attack; t_green_attack.id = loadBMP("Resources/Textures/green_attack.bmp"); t_green_attack.type = "texture_diffuse";
-	Texture t_cat_attack; t_cat_attack.id = loadBMP("Resources/Textures/cat_attack_texture.bmp"); t_cat_attack.type = "texture_diffuse";
-	Texture t_sewer_walls; t_sewer_walls.id = loadBMP("Resources/Textures/sewer_walls.bmp"); t_sewer_walls.type = "texture_diffuse";
-	Texture t_sewer_door; t_sewer_door.id = loadBMP("Resources/Textures/sewer_door.bmp"); t_sewer_door.type = "texture_diffuse";
-	Texture t_asphalt; t_asphalt.id = loadBMP("Resources/Textures/rock1.bmp"); t_asphalt.type = "texture_diffuse";
-	Texture t_car; t_car.id = loadBMP("Resources/Textures/car.bmp"); t_car.type = "texture_diffuse";
-
-	// Texture vectors for Loading
-	std::vector<Texture> texWood = { t_wood };
-	std::vector<Texture> texRock = { t_rock };
-	std::vector<Texture> texOrange = { t_orange };
-	std::vector<Texture> texWater = { t_dirty_water };
-	std::vector<Texture> texRat = { t_rat };
-	std::vector<Texture> texCat = { t_cat };
-	std::vector<Texture> texDoor = { t_sewer_door };
-	std::vector<Texture> texCar = { t_car };
-	std::vector<Texture> texAsphalt = { t_asphalt };
-	std::vector<Texture> texBuilding = { t_sewer_walls };
-
-	// --- Load Meshes ---
-	Mesh sphere = loader.loadObj("Resources/Models/sphere.obj", texOrange);
-	Mesh cube = loader.loadObj("Resources/Models/cube.obj", texWood);
-	Mesh terrain = loader.loadObj("Resources/Models/plane1.obj", texRock);
-	Mesh water = loader.loadObj("Resources/Models/plane1.obj", texWater);
-	Mesh ratMesh = loader.loadObj("Resources/Models/rat.obj", texRat);
-	Mesh greenSphere = loader.loadObj("Resources/Models/sphere.obj", { t_green_attack });
-	Mesh furBall = loader.loadObj("Resources/Models/fur_ball.obj", { t_cat_attack });
-	Mesh catMesh = loader.loadObj("Resources/Models/cat.obj", texCat);
-
-	// Sewers
-	Mesh sewerWall = loader.loadObj("Resources/Models/sewer_wall.obj", { t_sewer_walls });
-	Mesh sewerDoorMesh = loader.loadObj("Resources/Models/sewer_door.obj", texDoor);
-
-	// Street Replacement Meshes
-	Mesh streetGroundMesh = loader.loadObj("Resources/Models/plane1.obj", texAsphalt);
-	Mesh carMesh = loader.loadObj("Resources/Models/car.obj", texCar);
-	Mesh hutMesh = loader.loadObj("Resources/Models/hut.obj", texBuilding);
-
-	// Interior / Boss
-	Mesh lasagnaMesh = loader.loadObj("Resources/Models/lasagna.obj", texOrange);
-	Mesh bossMesh = loader.loadObj("Resources/Models/boss.obj", texRat);
-	Mesh cageMesh = loader.loadObj("Resources/Models/cage.obj", texBuilding);
-	Mesh keyMesh = loader.loadObj("Resources/Models/key.obj", texOrange);
-	Mesh boxMesh = loader.loadObj("Resources/Models/storage_box.obj", texWood);
+	// Worker threads read and decode the files, the GL objects are created between frames
+	// Files listed more than once (plane1.obj, sphere.obj, sewer_walls.png) are uploaded once and shared
+	bool serialLoad = argc > 1 && strcmp(argv[1], "--serial-load") == 0;
+	AssetRegistry registry;
+	LevelStreamer levels(registry, serialLoad ? 0 : std::max(1u, std::thread::hardware_concurrency()));
+
+	Mesh sphere, cube, terrain, ratMesh, greenSphere, furBall, catMesh;
+	Mesh sewerWall, sewerDoorMesh;
+	Mesh carMesh, hutMesh, lasagnaMesh, bossMesh, cageMesh, keyMesh, boxMesh;
+
+	// --- Level manifests ---
+	// Only the current level and the next one are resident; the next one loads in the background
+	LevelManifest gameplay;
+	gameplay.mesh(catMesh, "Resources/Models/cat.obj", { "Resources/Textures/cat_color.bmp" })
+		.mesh(terrain, "Resources/Models/plane1.obj", { "Resources/Textures/rock1.bmp" })
+		.mesh(sphere, "Resources/Models/sphere.obj", { "Resources/Textures/orange.bmp" })
+		.mesh(cube, "Resources/Models/cube.obj", { "Resources/Textures/wood.bmp" })
+		.mesh(greenSphere, "Resources/Models/sphere.obj", { "Resources/Textures/green_attack.bmp" })
+		.mesh(furBall, "Resources/Models/fur_ball.obj", { "Resources/Textures/cat_attack_texture.bmp" });
+
+	LevelManifest sewers;
+	sewers.include(gameplay)
+		.mesh(ratMesh, "Resources/Models/rat.obj", { "Resources/Textures/mouse.bmp" })
+		.mesh(sewerWall, "Resources/Models/sewer_wall.obj", { "Resources/Textures/sewer_walls.png" })
+		.mesh(sewerDoorMesh, "Resources/Models/sewer_door.obj", { "Resources/Textures/sewer_door.bmp" });
+
+	LevelManifest street;
+	street.include(gameplay)
+		.mesh(carMesh, "Resources/Models/car.obj", { "Resources/Textures/car.bmp" })
+		.mesh(hutMesh, "Resources/Models/hut.obj", { "Resources/Textures/sewer_walls.png" })
+		.mesh(lasagnaMesh, "Resources/Models/lasagna.obj", { "Resources/Textures/orange.bmp" })
+		.mesh(keyMesh, "Resources/Models/key.obj", { "Resources/Textures/orange.bmp" })
+		.mesh(cageMesh, "Resources/Models/cage.obj", { "Resources/Textures/sewer_walls.png" })
+		.mesh(bossMesh, "Resources/Models/boss.obj", { "Resources/Textures/mouse.bmp" });
+
+	LevelManifest bossRescue;
+	bossRescue.include(gameplay)
+		.mesh(hutMesh, "Resources/Models/hut.obj", { "Resources/Textures/sewer_walls.png" })
+		.mesh(cageMesh, "Resources/Models/cage.obj", { "Resources/Textures/sewer_walls.png" })
+		.mesh(bossMesh, "Resources/Models/boss.obj", { "Resources/Textures/mouse.bmp" })
+		.mesh(keyMesh, "Resources/Models/key.obj", { "Resources/Textures/orange.bmp" });
+
+	// Menus draw no meshes, they only say what to prefetch.
+	// Each level names the state the game enters after it: SEWERS -> STREET -> BOSS_RESCUE.
+	// MEN_LASAGNA and KEY_PUZZLE are never entered, so they have no manifest.
+	levels.addLevel(MENU, LevelManifest(), SEWERS);
+	levels.addLevel(STORY_SCREEN, LevelManifest(), SEWERS);
+	levels.addLevel(SEWERS, sewers, STREET);
+	levels.addLevel(STREET, street, BOSS_RESCUE);
+	levels.addLevel(BOSS_RESCUE, bossRescue, WIN_SCREEN);
+	levels.addLevel(WIN_SCREEN, LevelManifest(), MENU);
+	levels.addLevel(GAME_OVER, LevelManifest(), SEWERS);
+
+	// Edited models, textures and shaders are swapped in between frames
+	HotReloader hotReload(registry);
+	hotReload.watch("Resources");
+	hotReload.watch("Shaders");
+	hotReload.addShader(shader, "Shaders/vertex_shader.glsl", "Shaders/fragment_shader.glsl");
+	hotReload.addShader(waterShader, "Shaders/water_vertex_shader.glsl", "Shaders/water_fragment_shader.glsl");
 
 	GameState state = MENU;
 
@@ -309,10 +346,30 @@ int main()
 	bool sewerLevelComplete = false;
 	bool prevFPressed = false;
 
-	glEnable(GL_DEPTH_TEST);
+	// Render stats (toggle with F3)
+	LodSettings lodSettings;
+	LodStats lodStats;
+	bool showRenderStats = false;
+	bool prevF3Pressed = false;
+
+	// Uniform handles are resolved once; set() skips values the program already holds
+	const Shader::Uniform uUseTexture = Shader::uniform("useTexture");
+	const Shader::Uniform uLightColor = Shader::uniform("lightColor");
+	const Shader::Uniform uLightPos = Shader::uniform("lightPos");
+	const Shader::Uniform uViewPos = Shader::uniform("viewPos");
+
+	// Every mesh of the frame is submitted to the queue, sorted by shader, texture, mesh and depth,
+	// and drawn through the batch, which merges copies of the same mesh into one instanced draw
+	RenderQueue renderQueue;
+	InstanceBatch instances;
+	// Objects outside the view frustum are dropped before they reach the queue
+	CullBatch culling;
 
 	while (!window.isPressed(GLFW_KEY_ESCAPE) && glfwWindowShouldClose(window.getWindow()) == 0)
 	{
+		hotReload.update();
+		levels.update(state);
+
 		window.clear();
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
@@ -323,6 +380,15 @@ int main()
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
 
+		bool f3Pressed = window.isPressed(GLFW_KEY_F3);
+		if (f3Pressed && !prevF3Pressed) showRenderStats = !showRenderStats;
+		prevF3Pressed = f3Pressed;
+		lodStats.reset();
+		shader.resetUniformStats();
+		GLState::shared().resetStats();
+		renderQueue.resetStats();
+		instances.resetStats();
+
 		if (state == MENU) {
 			ImGui::SetNextWindowPos(ImVec2(0, 0));
 			ImGui::SetNextWindowSize(io.DisplaySize);
@@ -864,7 +930,8 @@ int main()
 			}
 
 			// --- RENDER 3D SCENE ---
-			glm::mat4 Projection = glm::perspective(45.0f, (float)window.getWidth() / (float)window.getHeight(), 0.1f, 1000.0f);
+			const float FAR_PLANE = 1000.0f;
+			glm::mat4 Projection = glm::perspective(45.0f, (float)window.getWidth() / (float)window.getHeight(), 0.1f, FAR_PLANE);
 			glm::mat4 View = glm::lookAt(camera.getCameraPosition(), camera.getCameraPosition() + camera.getCameraViewDirection(), camera.getCameraUp());
 
 			// NOTE: Sewer "water" disabled. We render the sewer floor using the existing rock texture (rock.bmp)
@@ -873,13 +940,14 @@ int main()
 			const float SEWER_OBJECT_Y = -5.0f;
 			const float SEWER_PLANE_Y = -20.0f;
 
+			GLState::shared().enable(GL_DEPTH_TEST);
 			shader.use();
-			glUniform3f(glGetUniformLocation(shader.getId(), "lightColor"), sunColor.x, sunColor.y, sunColor.z);
-			glUniform3f(glGetUniformLocation(shader.getId(), "lightPos"), sunPos.x, sunPos.y, sunPos.z);
+			shader.set(uLightColor, sunColor);
+			shader.set(uLightPos, sunPos);
 			glm::vec3 camP = camera.getCameraPosition();
-			glUniform3f(glGetUniformLocation(shader.getId(), "viewPos"), camP.x, camP.y, camP.z);
+			shader.set(uViewPos, camP);
 
-			auto DrawMesh = [&](Mesh& m, glm::vec3 pos, glm::vec3 s, float yaw = 0.0f, bool rotateX = false, bool rotateXDoor = false) {
+			auto ModelMatrix = [&](glm::vec3 pos, glm::vec3 s, float yaw, bool rotateX, bool rotateXDoor) {
 				glm::mat4 Model = glm::translate(glm::mat4(1.0f), pos);
 				if (yaw != 0.0f) Model = glm::rotate(Model, TO_RAD(yaw), glm::vec3(0.0f, 1.0f, 0.0f));
 
@@ -888,18 +956,32 @@ int main()
 				// Dedicated door X rotation path (legacy degrees(-90.0f) behavior)
 				if (rotateXDoor) Model = glm::rotate(Model, glm::degrees(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
 
-				Model = glm::scale(Model, s);
-				glm::mat4 MVP = Projection * View * Model;
-				glUniformMatrix4fv(glGetUniformLocation(shader.getId(), "MVP"), 1, GL_FALSE, &MVP[0][0]);
-				glUniformMatrix4fv(glGetUniformLocation(shader.getId(), "model"), 1, GL_FALSE, &Model[0][0]);
-				glUniform1i(glGetUniformLocation(shader.getId(), "useTexture"), 1);
-				m.draw(shader);
+				return glm::scale(Model, s);
+				};
+
+			// Pick the level of detail from the projected size of the mesh bounds
+			auto SelectLod = [&](Mesh& m, const glm::mat4& Model) {
+				unsigned int lod = 0;
+				if (m.getLodCount() > 0) {
+					float pixels = LodSettings::screenPixels(m.geometry->boundsMin, m.geometry->boundsMax, Model, camP, Projection, (float)window.getHeight());
+					lod = lodSettings.select(pixels, m.getLodCount());
+					lodStats.record(lod, m.getTriangleCount(0), m.getTriangleCount(lod));
+				}
+				return lod;
+				};
+
+			shader.set(uUseTexture, 1);
+
+			// Nothing is drawn here; the scene is culled, then the survivors go out sorted
+			auto DrawMesh = [&](Mesh& m, glm::vec3 pos, glm::vec3 s, float yaw = 0.0f, bool rotateX = false, bool rotateXDoor = false) {
+				culling.add(m, ModelMatrix(pos, s, yaw, rotateX, rotateXDoor));
 				};
+			culling.begin();
 
 			if (!firstPersonView) DrawMesh(catMesh, player.pos, player.scale, playerYaw);
 
 			if (state == SEWERS) {
-				// Flat sewer floor using rock.bmp (terrain mesh already uses texRock).
+				// Flat sewer floor using rock.bmp (terrain is listed with rock1.bmp).
 				DrawMesh(terrain, glm::vec3(0.0f, SEWER_PLANE_Y, 0.0f), glm::vec3(28.0f, 1.0f, 200.0f), 0.0f, true);
 				for (auto& w : sewerWalls) if (w.active) { auto p = w.pos; p.y = SEWER_OBJECT_Y; DrawMesh(sewerWall, p, w.scale, w.yaw); }
 				if (exitDoor.active) { auto p = exitDoor.pos; p.y = SEWER_OBJECT_Y; DrawMesh(sewerDoorMesh, p, exitDoor.scale, exitDoor.yaw, false, true); }
@@ -943,9 +1025,38 @@ int main()
 				else if (i.type == 6) DrawMesh(keyMesh, i.pos, i.scale);
 				else DrawMesh(cube, i.pos, i.scale);
 			}
+
+			glm::mat4 viewProjection = Projection * View;
+			culling.cull(Frustum(viewProjection));
+
+			renderQueue.begin(camP, FAR_PLANE);
+			for (const CullBatch::Object& o : culling.getVisible())
+				renderQueue.submit(shader, *o.mesh, o.model, SelectLod(*o.mesh, o.model));
+			renderQueue.flush(instances, viewProjection);
 			// rescueCat removed
 		}
 
+		if (showRenderStats) {
+			ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 320, 20), ImGuiCond_FirstUseEver);
+			ImGui::Begin("Render stats", &showRenderStats, ImGuiWindowFlags_AlwaysAutoResize);
+			ImGui::Checkbox("LOD", &lodSettings.enabled);
+			for (unsigned int i = 0; i < MAX_MESH_LODS - 1; i++) {
+				std::string label = "LOD " + std::to_string(i + 1) + " below px";
+				ImGui::SliderFloat(label.c_str(), &lodSettings.thresholds[i], 1.0f, 600.0f, "%.0f");
+			}
+			ImGui::Text("Draws per LOD: %u / %u / %u / %u", lodStats.draws[0], lodStats.draws[1], lodStats.draws[2], lodStats.draws[3]);
+			ImGui::Text("Triangles: %llu drawn, %llu saved by LOD", lodStats.drawnTriangles, lodStats.getSavedTriangles());
+			ImGui::Text("Uniform uploads: %u sent, %u skipped as unchanged", shader.getUniformUploads(), shader.getSkippedUniformUploads());
+			ImGui::Text("GL state calls: %u issued, %u skipped as redundant", GLState::shared().getIssuedCalls(), GLState::shared().getSkippedCalls());
+			ImGui::Text("Frustum culling: %u drawn, %u culled", culling.getVisibleCount(), culling.getCulledCount());
+			ImGui::Text("Render queue: %u packets, %u shader and %u texture changes", renderQueue.getPacketCount(), renderQueue.getShaderChanges(), renderQueue.getMaterialChanges());
+			ImGui::Text("Instancing: %u copies in %u draw calls", instances.getInstanceCount(), instances.getDrawCount());
+			ImGui::End();
+		}
+
+		// ImGui and the uploads at the top of the next frame bind behind the tracker's back
+		GLState::shared().reset();
+
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
@@ -956,5 +1067,7 @@ int main()
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
 
+	TextureStaging::shared().release();
+
 	return 0;
 }
\ No newline at end of file